@@ -6,9 +6,17 @@ source ~/env.sh
 if [ "$FRT_ROBOT_ID" = "ferenc" ]; then
     echo "Starting ferenc..."
     chmod +x ~/bin/ferenc
-    ~/bin/ferenc
+    if [ -f ~/bin/ferenc.mission ]; then
+        ~/bin/ferenc ~/bin/ferenc.mission
+    else
+        ~/bin/ferenc
+    fi
 else
     echo "Starting viktor..."
     chmod +x ~/bin/viktor
-    ~/bin/viktor
+    if [ -f ~/bin/viktor.mission ]; then
+        ~/bin/viktor ~/bin/viktor.mission
+    else
+        ~/bin/viktor
+    fi
 fi
@@ -1,12 +1,27 @@
 #pragma once
 
+#include "src/color.hpp"
 #include "src/config.hpp"
+#include "src/control.hpp"
+#include "src/coroutine.hpp"
 #include "src/device.hpp"
 #include "src/file.hpp"
+#include "src/filter.hpp"
+#include "src/freshness.hpp"
+#include "src/fixed.hpp"
+#include "src/gyro.hpp"
 #include "src/logger.hpp"
 #include "src/motor.hpp"
+#include "src/motor_model.hpp"
+#include "src/parameters.hpp"
+#include "src/result.hpp"
 #include "src/sensor.hpp"
 #include "src/utility.hpp"
+#include "src/watchdog.hpp"
+#include "src/worker.hpp"
 #include "src/buttons.hpp"
 #include "src/sound.hpp"
 #include "src/led.hpp"
+#include "src/function.hpp"
+#include "src/scheduler.hpp"
+#include "src/tuning.hpp"
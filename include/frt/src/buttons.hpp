@@ -1,94 +1,267 @@
 #pragma once
 
+#include "function.hpp"
 #include "logger.hpp"
 
-#include <string_view>
-#include <vector>
-#include <cmath>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <linux/input.h>
+#include <sys/ioctl.h>
 
 namespace FRT
 {
 
-class Button;
-
+/// @brief The brick buttons, from the key events of their input device, read by a background thread.
+/// Reading a button is an atomic load and waiting for one sleeps, so neither costs CPU during a run.
 class Buttons
 {
-    const int file_descriptor;
-    std::vector<unsigned int> state;
+    public:
+        using Callback = InplaceFunction<void()>;
 
-    static constexpr char path[] = "/dev/input/by-path/platform-gpio_keys-event";
+        static constexpr size_t max_handlers = 8;
 
-    void read () const
-    {
-        const int error = ioctl(file_descriptor, EVIOCGKEY(state.size()), state.data());
-        if (error < 0) {
-            Logger::error("Button::read - ioctl read failed");
-        }
-    }
+    private:
+        static constexpr char path[] = "/dev/input/by-path/platform-gpio_keys-event";
+        // interval of checking whether to stop while no key event arrives
+        static constexpr int stop_check_ms = 100;
+
+        struct Handler
+        {
+            int key;
+            bool press;
+            Callback callback;
+        };
+
+        const int file_descriptor;
+        // one bit per key code, as the kernel reports them
+        std::array<std::atomic<uint32_t>, (KEY_CNT + 31) / 32> state {};
+
+        std::array<Handler, max_handlers> handlers;
+        // handlers are published by this count, so adding one needs no lock
+        std::atomic<size_t> handler_count = 0;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        // the device cannot be read, waiters give up instead of blocking for ever
+        std::atomic<bool> failed = false;
+        std::atomic<bool> running = false;
+        std::thread thread;
 
-    template <bool read = true>
-    bool is_pressed (const int button)
-    {
-        if constexpr (read) {
-            Buttons::read();
+        void set_state (const int key, const bool pressed)
+        {
+            const uint32_t mask = 1u << (key % 32);
+            if (pressed) {
+                state[key / 32].fetch_or(mask, std::memory_order_release);
+            } else {
+                state[key / 32].fetch_and(~mask, std::memory_order_release);
+            }
         }
-        return state[button / sizeof(unsigned long) / 8] & (1 << (button % (sizeof(unsigned long) * 8)));
-    }
 
-    void wait_until (const int button)
-    {
-        while (!is_pressed(button)) {
-            // busy wait
+        /// @brief The state at the start, later the events keep it up to date.
+        void read_initial_state ()
+        {
+            std::array<uint8_t, (KEY_CNT + 7) / 8> bits {};
+            if (ioctl(file_descriptor, EVIOCGKEY(bits.size()), bits.data()) < 0) {
+                Logger::error("Buttons::read_initial_state - ioctl read failed");
+                return;
+            }
+            for (int key = 0; key < KEY_CNT; key++) {
+                if (bits[key / 8] & (1 << (key % 8))) {
+                    set_state(key, true);
+                }
+            }
         }
-    }
 
-    struct Button
-    {
-        friend class Buttons;
+        void handle (const input_event &event)
+        {
+            // 2 is an autorepeat of a held key
+            if (event.type != EV_KEY || event.code >= KEY_CNT || event.value == 2) {
+                return;
+            }
 
-        const int bit;
-        Buttons &buttons;
+            const bool pressed = event.value == 1;
+            {
+                const std::scoped_lock lock(mutex);
+                set_state(event.code, pressed);
+            }
+            changed.notify_all();
 
-        Button (const int bit, Buttons &buttons)
-        : bit(bit),
-          buttons(buttons)
-        {}
+            const size_t count = handler_count.load(std::memory_order_acquire);
+            for (size_t index = 0; index < count; index++) {
+                Handler &handler = handlers[index];
+                if (handler.key == event.code && handler.press == pressed) {
+                    handler.callback();
+                }
+            }
+        }
 
-        public:
-            bool is_pressed () const
+        void fail (const char *operation)
+        {
+            Logger::error("Buttons::loop -", operation, "failed, buttons are not read anymore, ERRNO:", errno);
             {
-                return buttons.is_pressed(bit);
+                const std::scoped_lock lock(mutex);
+                failed.store(true, std::memory_order_release);
             }
+            changed.notify_all();
+        }
 
-            void wait_until () const
-            {
-                buttons.wait_until(bit);
+        static bool is_transient (const int error)
+        {
+            return error == EINTR || error == EAGAIN;
+        }
+
+        void loop ()
+        {
+            std::array<input_event, 16> events;
+            pollfd descriptor { .fd = file_descriptor, .events = POLLIN, .revents = 0 };
+
+            while (running.load(std::memory_order_relaxed)) {
+                const int ready = poll(&descriptor, 1, stop_check_ms);
+                if (ready < 0 && !is_transient(errno)) {
+                    fail("poll");
+                    return;
+                }
+                if (ready <= 0) {
+                    continue;
+                }
+                const ssize_t size = ::read(file_descriptor, events.data(), sizeof(events));
+                if (size < 0 && is_transient(errno)) {
+                    continue;
+                }
+                if (size < 0) {
+                    fail("read");
+                    return;
+                }
+                for (size_t index = 0; index < size / sizeof(input_event); index++) {
+                    handle(events[index]);
+                }
             }
-    };
+        }
+
+        void add_handler (const int key, const bool press, Callback &&callback)
+        {
+            const size_t index = handler_count.load(std::memory_order_relaxed);
+            if (index == max_handlers) {
+                Logger::error("Buttons::add_handler - too many handlers, increase Buttons::max_handlers");
+                return;
+            }
+            handlers[index] = Handler { key, press, std::move(callback) };
+            handler_count.store(index + 1, std::memory_order_release);
+        }
 
     public:
+        bool is_pressed (const int key) const
+        {
+            return state[key / 32].load(std::memory_order_acquire) & (1u << (key % 32));
+        }
+
+        /// @brief False once the buttons cannot be read, their states are frozen then.
+        bool is_working () const
+        {
+            return !failed.load(std::memory_order_acquire);
+        }
+
+        /// @returns False if the key was not pressed before the timeout, or the buttons cannot be read.
+        bool wait_until (const int key, const std::chrono::milliseconds timeout)
+        {
+            std::unique_lock lock(mutex);
+            return changed.wait_for(lock, timeout, [this, key] { return is_pressed(key) || !is_working(); }) && is_pressed(key);
+        }
+
+        /// @returns False if the buttons cannot be read, instead of blocking for ever.
+        bool wait_until (const int key)
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [this, key] { return is_pressed(key) || !is_working(); });
+            return is_pressed(key);
+        }
+
+        struct Button
+        {
+            friend class Buttons;
+
+            const int key;
+            Buttons &buttons;
+
+            Button (const int key, Buttons &buttons)
+            : key(key),
+              buttons(buttons)
+            {}
+
+            public:
+                bool is_pressed () const
+                {
+                    return buttons.is_pressed(key);
+                }
+
+                /// @returns False if the buttons cannot be read.
+                bool wait_until () const
+                {
+                    return buttons.wait_until(key);
+                }
+
+                /// @returns False if the button was not pressed before the timeout, or the buttons cannot be read.
+                bool wait_until (const std::chrono::milliseconds timeout) const
+                {
+                    return buttons.wait_until(key, timeout);
+                }
+
+                /// @brief Calls the callback on the background thread when the button is pressed. Add handlers from a single thread.
+                template <typename Callable>
+                void on_press (Callable &&callable) const
+                {
+                    buttons.add_handler(key, true, Callback(std::forward<Callable>(callable)));
+                }
+
+                template <typename Callable>
+                void on_release (Callable &&callable) const
+                {
+                    buttons.add_handler(key, false, Callback(std::forward<Callable>(callable)));
+                }
+        };
+
         const Button left = { KEY_LEFT, *this };
         const Button right = { KEY_RIGHT, *this };
         const Button up = { KEY_UP, *this };
         const Button down = { KEY_DOWN, *this };
         const Button enter = { KEY_ENTER, *this };
-        const Button back = { KEY_BACK, *this };
-        
+        // the EV3 reports its back button as backspace
+        const Button back = { KEY_BACKSPACE, *this };
+
         Buttons ()
-        : file_descriptor(open(path, O_RDONLY)),
-          state(std::ceil(KEY_CNT / sizeof(unsigned long) / 8), 0)
-        {}
+        : file_descriptor(open(path, O_RDONLY | O_CLOEXEC))
+        {
+            if (file_descriptor < 0) {
+                Logger::error("Buttons - cannot open", path);
+                failed.store(true, std::memory_order_release);
+                return;
+            }
+            read_initial_state();
+            running.store(true, std::memory_order_relaxed);
+            thread = std::thread(&Buttons::loop, this);
+        }
+
+        Buttons (const Buttons &) = delete;
 
         ~Buttons ()
         {
+            if (running.exchange(false)) {
+                thread.join();
+            }
             if (file_descriptor != -1) {
                 close(file_descriptor);
             }
         }
 };
 
-} // namespace
\ No newline at end of file
+} // namespace
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "function.hpp"
+#include "sensor.hpp"
+#include "utility.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace FRT
+{
+
+/// @brief Nearest centroid classification of color readings, with centroids calibrated from samples on the field.
+/// @tparam channels Number of values per reading, e.g. 3 for RGB.
+/// @tparam classes Number of colors to tell apart.
+template <size_t channels, size_t classes>
+class ColorClassifier
+{
+    public:
+        static constexpr int unknown = -1;
+        using Values = std::array<int, channels>;
+
+    private:
+        struct Centroid
+        {
+            std::array<int64_t, channels> sum {};
+            int samples = 0;
+            Values mean {};
+        };
+
+        std::array<Centroid, classes> centroids;
+        // readings farther than this from every centroid are unknown
+        const int64_t max_distance_squared;
+
+    public:
+        ColorClassifier (const int max_distance)
+        : max_distance_squared((int64_t)max_distance * max_distance)
+        {}
+
+        /// @brief Adds a sample of a color to its centroid, e.g. while moving the sensor over a marking.
+        void calibrate (const size_t color, const Values &values)
+        {
+            auto &centroid = centroids.at(color);
+            centroid.samples++;
+            for (size_t channel = 0; channel < channels; channel++) {
+                centroid.sum[channel] += values[channel];
+                centroid.mean[channel] = centroid.sum[channel] / centroid.samples;
+            }
+        }
+
+        /// @brief Sets a centroid directly, e.g. from values stored after an earlier calibration.
+        void set_reference (const size_t color, const Values &values)
+        {
+            auto &centroid = centroids.at(color);
+            centroid.samples = 1;
+            centroid.mean = values;
+            for (size_t channel = 0; channel < channels; channel++) {
+                centroid.sum[channel] = values[channel];
+            }
+        }
+
+        const Values &get_reference (const size_t color) const
+        {
+            return centroids.at(color).mean;
+        }
+
+        /// @returns The index of the nearest calibrated color, or ColorClassifier::unknown.
+        int classify (const Values &values) const
+        {
+            int best = unknown;
+            int64_t best_distance = std::numeric_limits<int64_t>::max();
+
+            for (size_t color = 0; color < classes; color++) {
+                const auto &centroid = centroids[color];
+                if (centroid.samples == 0) {
+                    continue;
+                }
+                int64_t distance = 0;
+                for (size_t channel = 0; channel < channels; channel++) {
+                    const int64_t difference = values[channel] - centroid.mean[channel];
+                    distance += difference * difference;
+                }
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best = color;
+                }
+            }
+
+            return best_distance <= max_distance_squared ? best : unknown;
+        }
+};
+
+/// @brief Detects dark-light edges in the brightness with hysteresis, so noise at the edge gives a single event.
+class EdgeDetector
+{
+    private:
+        int low = 0, high = 0;
+        bool bright = false;
+        bool initialized = false;
+
+    public:
+        /// @brief Places the thresholds at a third and two thirds between the dark and the light brightness.
+        void calibrate (const int dark, const int light)
+        {
+            low = dark + (light - dark) / 3;
+            high = dark + (light - dark) * 2 / 3;
+        }
+
+        /// @returns 1 on a dark to light edge, -1 on a light to dark edge, 0 otherwise.
+        int update (const int brightness)
+        {
+            if (!initialized) {
+                bright = brightness >= high;
+                initialized = true;
+                return 0;
+            }
+            if (!bright && brightness >= high) {
+                bright = true;
+                return 1;
+            }
+            if (bright && brightness <= low) {
+                bright = false;
+                return -1;
+            }
+            return 0;
+        }
+
+        bool is_bright () const
+        {
+            return bright;
+        }
+};
+
+struct ColorEvent
+{
+    enum class Type : uint8_t
+    {
+        color,
+        rising_edge,
+        falling_edge,
+    };
+
+    Type type;
+    // the previous and the new color for color events, ColorClassifier::unknown for edges
+    int from, to;
+    // timestamp of the reading in seconds, see FRT::time, to be matched with odometry
+    double time;
+};
+
+/// @brief Streaming color pipeline: the sensor stays in one mode, every poll reads all channels with a single bin_data read,
+/// classifies them and reports color changes and brightness edges with timestamps.
+/// Poll it at a high rate, e.g. from a Scheduler task or the drive loop.
+template <typename SensorType, size_t channels, size_t classes>
+class ColorPipeline
+{
+    public:
+        using Classifier = ColorClassifier<channels, classes>;
+        using Values = typename Classifier::Values;
+
+    private:
+        SensorType &sensor;
+        const std::string_view mode;
+        Classifier classifier;
+        EdgeDetector edges;
+        InplaceFunction<void(const ColorEvent &)> on_event;
+        // a new color has to be seen this many times in a row, a single reading across a boundary is often mixed
+        const int stable_samples;
+
+        int color = Classifier::unknown;
+        int candidate = Classifier::unknown;
+        int candidate_count = 0;
+        Values last {};
+
+    public:
+        template <typename Callback>
+        ColorPipeline (SensorType &sensor, const std::string_view mode, const Classifier &classifier, const EdgeDetector &edges, Callback &&on_event, const int stable_samples = 2)
+        : sensor(sensor),
+          mode(mode),
+          classifier(classifier),
+          edges(edges),
+          on_event(std::forward<Callback>(on_event)),
+          stable_samples(stable_samples)
+        {
+            sensor.set_mode(mode);
+        }
+
+        /// @brief Reads and processes one reading.
+        const Values &poll ()
+        {
+            sensor.set_mode(mode);
+            last = sensor.template get_values<channels>();
+            const double now = time();
+
+            int brightness = 0;
+            for (const int value : last) {
+                brightness += value;
+            }
+            if (const int edge = edges.update(brightness)) {
+                on_event(ColorEvent {
+                    edge > 0 ? ColorEvent::Type::rising_edge : ColorEvent::Type::falling_edge,
+                    Classifier::unknown, Classifier::unknown, now
+                });
+            }
+
+            const int classified = classifier.classify(last);
+            if (classified != candidate) {
+                candidate = classified;
+                candidate_count = 0;
+            }
+            if (++candidate_count == stable_samples && candidate != color) {
+                on_event(ColorEvent { ColorEvent::Type::color, color, candidate, now });
+                color = candidate;
+            }
+
+            return last;
+        }
+
+        int get_color () const
+        {
+            return color;
+        }
+
+        const Values &get_values () const
+        {
+            return last;
+        }
+
+        Classifier &get_classifier ()
+        {
+            return classifier;
+        }
+
+        EdgeDetector &get_edges ()
+        {
+            return edges;
+        }
+};
+
+} // namespace
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "fixed.hpp"
+#include "utility.hpp"
+
+namespace FRT
+{
+
+/// @brief PID controller generic over its number types, so the same loop can run in double or fixed-point.
+/// The integral is accumulated already multiplied by Ki, keeping it in range of the gain type.
+/// @tparam Number Type of the error and the output.
+/// @tparam Gain Type of the gains and the integral term.
+template <typename Number = double, typename Gain = Number>
+struct PID
+{
+    Gain Kp, Ki, Kd;
+    Gain integral = 0;
+    Number last_error = 0;
+
+    PID (const double Kp, const double Ki, const double Kd)
+    : Kp(Kp), Ki(Ki), Kd(Kd)
+    {}
+
+    /// @brief Derivative term from the change of the error since the last update.
+    Number update (const Number error)
+    {
+        const Number output = error * Kp + Number(integral) + (error - last_error) * Kd;
+        last_error = error;
+        integral += Ki * error;
+        return output;
+    }
+
+    /// @brief Derivative term from a measured rate, e.g. from a gyro.
+    Number update (const Number error, const Number rate)
+    {
+        const Number output = error * Kp + Number(integral) + rate * Kd;
+        last_error = error;
+        integral += Ki * error;
+        return output;
+    }
+};
+
+/// @brief Linear slowdown toward the end of a motion.
+/// @returns The fraction of the full speed, base + distance / threshold clamped to [low, 1].
+template <typename Number = double>
+constexpr Number ramp_down (const Number distance, const Number threshold, const Number base, const Number low = 0)
+{
+    if (distance >= threshold) {
+        return 1;
+    }
+    return clamp<Number>(base + distance / threshold, low, 1);
+}
+
+} // namespace
@@ -0,0 +1,504 @@
+#pragma once
+
+#include "file.hpp"
+#include "function.hpp"
+#include "logger.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <tuple>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace FRT
+{
+
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr exception;
+
+    struct FinalAwaiter
+    {
+        bool await_ready () noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend (std::coroutine_handle<Promise> handle) noexcept
+        {
+            return handle.promise().continuation;
+        }
+
+        void await_resume () noexcept {}
+    };
+
+    std::suspend_always initial_suspend () noexcept { return {}; }
+    FinalAwaiter final_suspend () noexcept { return {}; }
+
+    void unhandled_exception ()
+    {
+        exception = std::current_exception();
+    }
+
+    void rethrow ()
+    {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+template <typename T>
+struct Promise : public PromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object ();
+
+    void return_value (T result)
+    {
+        value = std::move(result);
+    }
+
+    T result ()
+    {
+        rethrow();
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : public PromiseBase
+{
+    Task<void> get_return_object ();
+
+    void return_void () {}
+
+    void result ()
+    {
+        rethrow();
+    }
+};
+
+} // namespace detail
+
+/// @brief Lazily started coroutine. Awaiting it runs it to completion and resumes the awaiting coroutine afterwards.
+/// Destroying a suspended task destroys its frame, cancelling everything it waits for.
+template <typename T>
+class Task
+{
+    public:
+        using promise_type = detail::Promise<T>;
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+    public:
+        explicit Task (const std::coroutine_handle<promise_type> handle)
+        : handle(handle)
+        {}
+
+        Task (Task &&other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+        {}
+
+        Task &operator= (Task &&other) noexcept
+        {
+            if (this != &other) {
+                if (handle) {
+                    handle.destroy();
+                }
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        Task (const Task &) = delete;
+
+        ~Task ()
+        {
+            if (handle) {
+                handle.destroy();
+            }
+        }
+
+        /// @brief Runs the task until its first suspension without waiting for it. See FRT::when_any.
+        void start ()
+        {
+            handle.resume();
+        }
+
+        bool done () const
+        {
+            return handle.done();
+        }
+
+        T result ()
+        {
+            return handle.promise().result();
+        }
+
+        /// @brief The exception the task finished with, if any.
+        std::exception_ptr exception () const
+        {
+            return handle.promise().exception;
+        }
+
+        bool await_ready () const noexcept
+        {
+            return handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend (const std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume ()
+        {
+            return result();
+        }
+};
+
+namespace detail
+{
+
+template <typename T>
+inline Task<T> Promise<T>::get_return_object ()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object ()
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/// @brief Single-threaded event loop resuming coroutines when their condition holds or their deadline passes.
+/// Between iterations it blocks on inotify events of the watched sysfs attributes, so waiting costs no CPU.
+class EventLoop
+{
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct Waiter
+        {
+            Waiter *previous = nullptr;
+            Waiter *next = nullptr;
+            bool linked = false;
+            unsigned long ready_iteration = 0;
+
+            std::coroutine_handle<> handle;
+            // optional, waiters without a condition only wait for their deadline
+            InplaceFunction<bool()> condition;
+            clock::time_point deadline = clock::time_point::max();
+            // optional sysfs attribute whose modification wakes up the loop
+            const char *path = nullptr;
+
+            Waiter () = default;
+
+            Waiter (Waiter &&other) noexcept
+            : condition(std::move(other.condition)),
+              deadline(other.deadline),
+              path(other.path)
+            {}
+
+            ~Waiter ()
+            {
+                if (linked) {
+                    EventLoop::current().remove(*this);
+                }
+            }
+
+            bool is_ready (const clock::time_point now)
+            {
+                return now >= deadline || (condition && condition());
+            }
+        };
+
+    private:
+        static inline thread_local EventLoop *current_loop = nullptr;
+
+        Waiter *head = nullptr;
+        unsigned long iteration = 0;
+        const int inotify_descriptor;
+        const clock::duration poll_period;
+
+        void poll_waiters ()
+        {
+            iteration++;
+            const auto now = clock::now();
+
+            // marking first, so coroutines suspending again are only checked in the next iteration
+            for (auto waiter = head; waiter; waiter = waiter->next) {
+                if (waiter->is_ready(now)) {
+                    waiter->ready_iteration = iteration;
+                }
+            }
+
+            // rescanning after every resumption, since it may destroy other waiters
+            bool resumed = true;
+            while (resumed) {
+                resumed = false;
+                for (auto waiter = head; waiter; waiter = waiter->next) {
+                    if (waiter->ready_iteration == iteration) {
+                        remove(*waiter);
+                        waiter->handle.resume();
+                        resumed = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        void wait_for_events ()
+        {
+            if (!head) {
+                return;
+            }
+
+            auto timeout = clock::duration::max();
+            for (auto waiter = head; waiter; waiter = waiter->next) {
+                if (waiter->condition) {
+                    timeout = std::min(timeout, poll_period);
+                }
+                if (waiter->deadline != clock::time_point::max()) {
+                    timeout = std::min(timeout, waiter->deadline - clock::now());
+                }
+            }
+
+            if (timeout <= clock::duration::zero()) {
+                return;
+            }
+
+            pollfd descriptor { .fd = inotify_descriptor, .events = POLLIN, .revents = 0 };
+            const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+            const timespec timeout_spec { .tv_sec = nanoseconds / 1'000'000'000, .tv_nsec = nanoseconds % 1'000'000'000 };
+            const bool infinite = timeout == clock::duration::max();
+
+            if (ppoll(&descriptor, inotify_descriptor < 0 ? 0 : 1, infinite ? nullptr : &timeout_spec, nullptr) > 0) {
+                // draining the events, they only serve as wake-ups
+                alignas(inotify_event) char buffer[1024];
+                while (::read(inotify_descriptor, buffer, sizeof(buffer)) > 0) {}
+            }
+        }
+
+    public:
+        /// @param poll_period Interval of checking conditions when no watched attribute changes.
+        EventLoop (const clock::duration poll_period = std::chrono::milliseconds(1))
+        : inotify_descriptor(inotify_init1(IN_NONBLOCK)),
+          poll_period(poll_period)
+        {
+            if (inotify_descriptor < 0) {
+                Logger::warning("EventLoop - inotify unavailable, falling back to polling");
+            }
+        }
+
+        EventLoop (const EventLoop &) = delete;
+
+        ~EventLoop ()
+        {
+            if (inotify_descriptor >= 0) {
+                close(inotify_descriptor);
+            }
+        }
+
+        /// @brief The loop running on this thread. Only valid inside EventLoop::run.
+        static EventLoop &current ()
+        {
+            return *current_loop;
+        }
+
+        void add (Waiter &waiter)
+        {
+            if (waiter.path && inotify_descriptor >= 0) {
+                inotify_add_watch(inotify_descriptor, waiter.path, IN_MODIFY);
+            }
+
+            waiter.previous = nullptr;
+            waiter.next = head;
+            if (head) {
+                head->previous = &waiter;
+            }
+            head = &waiter;
+            waiter.linked = true;
+        }
+
+        void remove (Waiter &waiter)
+        {
+            if (waiter.previous) {
+                waiter.previous->next = waiter.next;
+            } else {
+                head = waiter.next;
+            }
+            if (waiter.next) {
+                waiter.next->previous = waiter.previous;
+            }
+            waiter.previous = waiter.next = nullptr;
+            waiter.linked = false;
+        }
+
+        /// @brief Runs a task and every coroutine it starts on the calling thread until the task finishes.
+        template <typename T>
+        T run (Task<T> task)
+        {
+            const auto previous_loop = std::exchange(current_loop, this);
+
+            task.start();
+            while (!task.done()) {
+                wait_for_events();
+                poll_waiters();
+            }
+
+            current_loop = previous_loop;
+            return task.result();
+        }
+};
+
+struct WaiterAwaiter
+{
+    EventLoop::Waiter waiter;
+
+    bool await_ready ()
+    {
+        return waiter.condition && waiter.condition();
+    }
+
+    void await_suspend (const std::coroutine_handle<> handle)
+    {
+        waiter.handle = handle;
+        EventLoop::current().add(waiter);
+    }
+
+    void await_resume () {}
+};
+
+/// @brief Suspends the coroutine until the condition holds. The condition is checked on every loop iteration.
+template <typename Condition>
+inline WaiterAwaiter until (Condition &&condition)
+{
+    WaiterAwaiter awaiter;
+    awaiter.waiter.condition = std::forward<Condition>(condition);
+    return awaiter;
+}
+
+/// @brief Suspends the coroutine until the condition holds, waking up as soon as the given attribute changes.
+template <typename Condition>
+inline WaiterAwaiter until (Condition &&condition, const File &file)
+{
+    auto awaiter = until(std::forward<Condition>(condition));
+    awaiter.waiter.path = file.get_path().c_str();
+    return awaiter;
+}
+
+template <typename Rep, typename Period>
+inline WaiterAwaiter sleep_for (const std::chrono::duration<Rep, Period> duration)
+{
+    WaiterAwaiter awaiter;
+    awaiter.waiter.deadline = EventLoop::clock::now() + std::chrono::duration_cast<EventLoop::clock::duration>(duration);
+    return awaiter;
+}
+
+/// @brief Suspends the coroutine until the next loop iteration, lets control loops share the thread.
+inline WaiterAwaiter next_tick ()
+{
+    WaiterAwaiter awaiter;
+    awaiter.waiter.deadline = EventLoop::clock::now();
+    return awaiter;
+}
+
+namespace detail
+{
+
+template <typename T>
+inline Task<T> as_task (Task<T> task)
+{
+    return task;
+}
+
+template <typename Awaitable>
+inline Task<> as_task (Awaitable awaitable)
+{
+    co_await std::move(awaitable);
+}
+
+/// @brief Logs the exception of a finished task whose result nobody takes, so it is not lost silently.
+template <typename T>
+inline void log_exception (const Task<T> &task, const char *caller)
+{
+    if (!task.done() || !task.exception()) {
+        return;
+    }
+    try {
+        std::rethrow_exception(task.exception());
+    } catch (const std::exception &error) {
+        Logger::error(caller, "- a child task failed:", error.what());
+    } catch (...) {
+        Logger::error(caller, "- a child task failed with an unknown exception");
+    }
+}
+
+template <typename Tuple>
+inline size_t first_done (Tuple &tasks)
+{
+    return std::apply([] (auto &...task) {
+        size_t index = 0;
+        const bool found = ((task.done() || (index++, false)) || ...);
+        return found ? index : sizeof...(task);
+    }, tasks);
+}
+
+} // namespace detail
+
+/// @brief Runs tasks or awaitables concurrently and completes with the first one, e.g. when_any(turn_to(90deg), sleep_for(2s)).
+/// The rest are cancelled. An exception of the first one is rethrown, the ones of others finished meanwhile are logged.
+/// @returns The index of the completed argument.
+template <typename... Awaitables>
+inline Task<size_t> when_any (Awaitables... awaitables)
+{
+    auto tasks = std::make_tuple(detail::as_task(std::move(awaitables))...);
+    std::apply([] (auto &...task) { (task.start(), ...); }, tasks);
+
+    co_await until([&tasks] { return detail::first_done(tasks) < sizeof...(Awaitables); });
+    const size_t winner = detail::first_done(tasks);
+
+    // before the losers are cancelled by the destruction of the tuple
+    std::apply([winner] (auto &...task) {
+        size_t index = 0;
+        ((index++ == winner ? (void)task.result() : detail::log_exception(task, "when_any")), ...);
+    }, tasks);
+    co_return winner;
+}
+
+/// @brief Runs tasks or awaitables concurrently and completes when all of them did.
+/// The first exception in argument order is rethrown, the rest are logged.
+template <typename... Awaitables>
+inline Task<> when_all (Awaitables... awaitables)
+{
+    auto tasks = std::make_tuple(detail::as_task(std::move(awaitables))...);
+    std::apply([] (auto &...task) { (task.start(), ...); }, tasks);
+
+    co_await until([&tasks] { return std::apply([] (auto &...task) { return (task.done() && ...); }, tasks); });
+
+    std::exception_ptr first;
+    std::apply([&first] (auto &...task) {
+        ((first ? detail::log_exception(task, "when_all") : (void)(first = task.exception())), ...);
+    }, tasks);
+    if (first) {
+        std::rethrow_exception(first);
+    }
+}
+
+} // namespace
@@ -28,8 +28,9 @@ class Device
     protected:
         std::string prefix;
 
-        FRT::File attribute (const std::string_view filename) {
-            return FRT::File(prefix + (std::string)filename);
+        template <typename AttributeFile = FRT::File>
+        AttributeFile attribute (const std::string_view filename) {
+            return AttributeFile(prefix + (std::string)filename);
         }
 
     public:
@@ -2,13 +2,18 @@
 
 #include "config.hpp"
 #include "logger.hpp"
+#include "result.hpp"
 
+#include <atomic>
+#include <cassert>
 #include <fstream>
 #include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 #include <errno.h>
+#include <fcntl.h>
 
 #include <sys/inotify.h>
 #include <unistd.h>
@@ -16,51 +21,134 @@
 namespace FRT
 {
 
-class File
+/// @brief Locking policy of files used by one thread at a time, e.g. the LEDs written by the status lights, costs nothing.
+struct NoLocking
+{
+    struct Guard {};
+
+    Guard lock () const
+    {
+        return Guard {};
+    }
+};
+
+/// @brief Locking policy of files shared by threads, e.g. the wheel speeds read by the control loop and the gyro processor.
+struct MutexLocking
+{
+    mutable std::mutex mutex;
+
+    std::unique_lock<std::mutex> lock () const
+    {
+        return std::unique_lock(mutex);
+    }
+};
+
+/// @brief Locking policy of files owned by a single thread, e.g. the attributes a motor is driven through, without locking.
+/// The first thread using the file owns it, debug builds assert that no other thread uses it.
+struct ThreadConfinedLocking
+{
+    struct Guard {};
+
+#ifndef NDEBUG
+    mutable std::atomic<std::thread::id> owner {};
+#endif
+
+    Guard lock () const
+    {
+#ifndef NDEBUG
+        std::thread::id expected {};
+        const auto current = std::this_thread::get_id();
+        if (!owner.compare_exchange_strong(expected, current, std::memory_order_relaxed)) {
+            assert(expected == current && "ThreadConfinedLocking - file used by a second thread");
+        }
+#endif
+        return Guard {};
+    }
+};
+
+/// @brief Error counters of a file, see BasicFile::get_errors.
+struct FileErrors
+{
+    uint32_t reads = 0, writes = 0;
+    // accesses that failed after every attempt
+    uint32_t read_failures = 0, write_failures = 0;
+    // attempts beyond the first
+    uint32_t retries = 0;
+    // binary reads returning fewer bytes than asked, see BasicFile::read_bytes
+    uint32_t short_reads = 0;
+    int last_errno = 0;
+};
+
+/// @brief Attribute file of sysfs, read and written through streams.
+/// Failed accesses are retried a bounded number of times, then reported as a Result and counted, never blocking or throwing.
+/// @tparam Locking Locking policy of each access, see NoLocking, MutexLocking and ThreadConfinedLocking.
+template <typename Locking = MutexLocking>
+class BasicFile
 {
     protected:
         std::string path;
         std::ifstream input_stream;
         std::ofstream output_stream;
-        mutable std::recursive_mutex mutex;
+        [[no_unique_address]] Locking locking;
         const int file_descriptor;
+        // for binary reads, opened on first use
+        int raw_descriptor = -1;
 
-        template <bool silent = false>
-        void ensure_input ()
+        // updated under the lock, read from any thread
+        struct Counters
+        {
+            std::atomic<uint32_t> reads = 0, writes = 0;
+            std::atomic<uint32_t> read_failures = 0, write_failures = 0;
+            std::atomic<uint32_t> retries = 0;
+            std::atomic<uint32_t> short_reads = 0;
+            std::atomic<int> last_errno = 0;
+        } counters;
+
+        bool ensure_input ()
         {
             if (!input_stream.is_open()) {
                 input_stream.open(path);
-
                 if (!input_stream.is_open()) {
-                    if constexpr (!silent) {
-                        Logger::error("File::ensure_input - cannot open file", path);
-                    }
+                    return false;
                 }
             }
             // getting rid of error state flags like EOF
             input_stream.clear();
             // changing the read position to the beginning of the file
             input_stream.seekg(0, std::ios::beg);
+            return true;
         }
 
-        void ensure_output ()
+        bool ensure_output ()
         {
             if (!output_stream.is_open()) {
                 output_stream.rdbuf()->pubsetbuf(NULL, 0);
                 output_stream.open(path);
-
                 if (!output_stream.is_open()) {
-                    Logger::error("File::ensure_input - cannot open file", path);
+                    return false;
                 }
             }
 
             output_stream.clear();
+            return true;
         }
 
-        std::vector<std::string> read_set (int attempts = 2)
+        /// @brief Counts a failed access and logs the first one and every 100th, a flaky cable must not flood the log.
+        template <bool silent>
+        IOError fail (std::atomic<uint32_t> &failures, const IOError error, const std::string_view operation)
         {
-            const auto line = read_line(attempts);
+            counters.last_errno.store(errno, std::memory_order_relaxed);
+            const uint32_t count = failures.fetch_add(1, std::memory_order_relaxed) + 1;
+            if constexpr (!silent) {
+                if (count == 1 || count % 100 == 0) {
+                    Logger::error("File::" + std::string(operation), "- failed on", path, "ERRNO:", errno, "failures:", count);
+                }
+            }
+            return error;
+        }
 
+        static std::vector<std::string> split (const std::string &line)
+        {
             std::vector<std::string> result;
             std::string buffer;
             
@@ -83,86 +171,183 @@ class File
         }
 
     public:
-        File (const std::string &path) 
+        BasicFile (const std::string &path) 
         : path(path), file_descriptor(inotify_init())
         {}
 
-        virtual ~File () {}
+        virtual ~BasicFile ()
+        {
+            if (raw_descriptor >= 0) {
+                close(raw_descriptor);
+            }
+        }
 
-        /// @brief Reads data from the beginning of the file. Reading strings stops at any whitespace, see File::read_line if needed.
+        const std::string &get_path () const
+        {
+            return path;
+        }
+
+        /// @brief Reads data from the beginning of the file. Reading strings stops at any whitespace, see File::try_read_line if needed.
         /// @tparam T Type of data to read. Arithmetic types, std::string and std::vector<std::string> are typical.
         /// @tparam silent Option to suppress error messages. Useful when probing for devices. Defaults to false.
-        /// @param attempts Determines how many times to retry in case of failure. Defaults to two.
+        /// @param attempts Determines how many times to try in case of failure. Defaults to two.
         template <typename T, bool silent = false>
-        T read (int attempts = 2)
+        Result<T> try_read (const int attempts = 2)
         {
             if constexpr (std::is_same_v<T, std::vector<std::string>>) {
-                return read_set(attempts);
-            } else {
-                if (attempts == 0) {
-                    if constexpr (!silent) Logger::error("File::read - attempts reached zero");
+                const auto line = try_read_line<silent>(attempts);
+                if (!line) {
+                    return line.error();
                 }
+                return split(*line);
+            } else {
+                // locked once, the retries stay inside
+                [[maybe_unused]] const auto guard = locking.lock();
+                counters.reads.fetch_add(1, std::memory_order_relaxed);
 
-                const auto lock = std::scoped_lock(mutex);
-                ensure_input<silent>();
+                IOError error = IOError::open;
+                for (int attempt = 0; attempt < attempts; attempt++) {
+                    if (attempt > 0) {
+                        counters.retries.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    if (!ensure_input()) {
+                        error = IOError::open;
+                        continue;
+                    }
 
-                try {
-                    T result;
+                    T result {};
                     input_stream >> result;
-                    return result;
-                } 
-                catch (...) {
-                    if constexpr (!silent) Logger::warning("File::read - read from", path, "failed");
+                    // an empty attribute is an empty string, e.g. the state of an idle motor
+                    if (!input_stream.fail() || (std::is_same_v<T, std::string> && input_stream.eof() && !input_stream.bad())) {
+                        return result;
+                    }
+                    error = IOError::read;
                     input_stream.close();
                     input_stream.clear();
-                    return read<T>(attempts - 1);
                 }
+
+                return fail<silent>(counters.read_failures, error, "read");
             }
         }
 
+        /// @brief File::try_read with a default constructed value on failure.
+        template <typename T, bool silent = false>
+        T read (const int attempts = 2)
+        {
+            return try_read<T, silent>(attempts).value();
+        }
+
         /// @brief Reads a whole line from the beginning of the file.
-        /// @param attempts Determines how many times to retry in case of failure. Defaults to two.
-        std::string read_line (int attempts = 2)
+        /// @param attempts Determines how many times to try in case of failure. Defaults to two.
+        template <bool silent = false>
+        Result<std::string> try_read_line (const int attempts = 2)
         {
-            if (attempts == 0) {
-                Logger::error("File::read_line - attempts reached zero");
-            }
+            [[maybe_unused]] const auto guard = locking.lock();
+            counters.reads.fetch_add(1, std::memory_order_relaxed);
 
-            const auto lock = std::scoped_lock(mutex);
-            ensure_input();
+            IOError error = IOError::open;
+            for (int attempt = 0; attempt < attempts; attempt++) {
+                if (attempt > 0) {
+                    counters.retries.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (!ensure_input()) {
+                    error = IOError::open;
+                    continue;
+                }
 
-            try {
                 std::string result;
                 std::getline(input_stream, result);
-                return result;
-            } 
-            catch (...) {
-                Logger::warning("File::read_line - read from", path, "failed");
+                if (!input_stream.bad() && (!input_stream.fail() || input_stream.eof())) {
+                    return result;
+                }
+                error = IOError::read;
                 input_stream.close();
-                return read_line(attempts - 1);
+                input_stream.clear();
             }
+
+            return fail<silent>(counters.read_failures, error, "read_line");
+        }
+
+        std::string read_line (const int attempts = 2)
+        {
+            return try_read_line(attempts).value();
+        }
+
+        /// @brief Reads raw bytes with a single system call, e.g. bin_data of sensors.
+        /// @param offset Position in the file, the register address for the direct attribute of I2C sensors.
+        /// @returns The number of bytes read, -1 on failure. Failures and short reads are counted and logged.
+        ssize_t read_bytes (void *buffer, const size_t size, const off_t offset = 0)
+        {
+            [[maybe_unused]] const auto guard = locking.lock();
+            counters.reads.fetch_add(1, std::memory_order_relaxed);
+
+            if (raw_descriptor < 0) {
+                raw_descriptor = open(path.c_str(), O_RDONLY);
+                if (raw_descriptor < 0) {
+                    fail<false>(counters.read_failures, IOError::open, "read_bytes");
+                    return -1;
+                }
+            }
+
+            const ssize_t result = pread(raw_descriptor, buffer, size, offset);
+            if (result < 0) {
+                fail<false>(counters.read_failures, IOError::read, "read_bytes");
+            } else if ((size_t)result < size) {
+                // e.g. a sensor switching modes meanwhile, not an error of the system call, but the values are incomplete
+                const uint32_t count = counters.short_reads.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (count == 1 || count % 100 == 0) {
+                    Logger::error("File::read_bytes - read", result, "of", size, "bytes from", path, "short reads:", count);
+                }
+            }
+            return result;
         }
 
         /// @brief Writes data to the file.
         /// @tparam T Type of data to write. Arithmetic types and std::string are typical.
-        /// @param attempts Determines how many times to retry in case of failure. Defaults to two.
+        /// @param attempts Determines how many times to try in case of failure. Defaults to two.
         template <typename T>
-        void write (const T &value, int attempts = 2)
+        Result<void> try_write (const T &value, const int attempts = 2)
         {
-            if (attempts == 0) {
-                Logger::error("File::write - attempts reached zero");
-            }
+            [[maybe_unused]] const auto guard = locking.lock();
+            counters.writes.fetch_add(1, std::memory_order_relaxed);
 
-            const auto lock = std::scoped_lock(mutex);
-            ensure_output();
+            IOError error = IOError::open;
+            for (int attempt = 0; attempt < attempts; attempt++) {
+                if (attempt > 0) {
+                    counters.retries.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (!ensure_output()) {
+                    error = IOError::open;
+                    continue;
+                }
 
-            if (output_stream << value << std::flush) {
-                return;
+                if (output_stream << value << std::flush) {
+                    return {};
+                }
+                error = IOError::write;
+                output_stream.close();
             }
 
-            Logger::warning("File::write - write to", path, "failed, ERRNO:", errno);
-            output_stream.close();
-            return write<T>(value, attempts - 1);
+            return fail<false>(counters.write_failures, error, "write");
+        }
+
+        template <typename T>
+        void write (const T &value, const int attempts = 2)
+        {
+            try_write(value, attempts);
+        }
+
+        FileErrors get_errors () const
+        {
+            return FileErrors {
+                counters.reads.load(std::memory_order_relaxed),
+                counters.writes.load(std::memory_order_relaxed),
+                counters.read_failures.load(std::memory_order_relaxed),
+                counters.write_failures.load(std::memory_order_relaxed),
+                counters.retries.load(std::memory_order_relaxed),
+                counters.short_reads.load(std::memory_order_relaxed),
+                counters.last_errno.load(std::memory_order_relaxed),
+            };
         }
 
         void wait ()
@@ -173,4 +358,9 @@ class File
         }
 };
 
+// device attributes pick their policy, see TachoMotorInterface, SensorInterface and LEDInterface
+using File = BasicFile<MutexLocking>;
+using ConfinedFile = BasicFile<ThreadConfinedLocking>;
+using UnlockedFile = BasicFile<NoLocking>;
+
 } // namespace
\ No newline at end of file
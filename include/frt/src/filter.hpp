@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace FRT
+{
+
+/// @brief Fixed-size circular buffer keeping the last size values, without allocation.
+template <typename T, size_t size>
+class RingBuffer
+{
+    static_assert(size > 0, "RingBuffer - size must be positive");
+
+    private:
+        std::array<T, size> values {};
+        size_t next = 0;
+        size_t count = 0;
+
+    public:
+        void push (const T &value)
+        {
+            values[next] = value;
+            next = (next + 1) % size;
+            count = std::min(count + 1, size);
+        }
+
+        /// @brief Values from the oldest, index 0, to the newest.
+        const T &operator[] (const size_t index) const
+        {
+            return values[(next + size - count + index) % size];
+        }
+
+        size_t get_count () const
+        {
+            return count;
+        }
+
+        bool full () const
+        {
+            return count == size;
+        }
+
+        void clear ()
+        {
+            next = count = 0;
+        }
+};
+
+/// @brief Median of the last size values, removes single outliers without smoothing edges.
+template <typename Number, size_t size>
+class MedianFilter
+{
+    static_assert(size % 2 == 1, "MedianFilter - use an odd size");
+
+    private:
+        RingBuffer<Number, size> buffer;
+
+    public:
+        Number update (const Number value)
+        {
+            buffer.push(value);
+
+            std::array<Number, size> sorted;
+            const size_t count = buffer.get_count();
+            for (size_t index = 0; index < count; index++) {
+                sorted[index] = buffer[index];
+            }
+            std::nth_element(sorted.begin(), sorted.begin() + count / 2, sorted.begin() + count);
+            return sorted[count / 2];
+        }
+};
+
+/// @brief Exponential moving average, value += alpha * (input - value). Starts from the first input.
+template <typename Number = double>
+class EMAFilter
+{
+    private:
+        const Number alpha;
+        Number value = 0;
+        bool initialized = false;
+
+    public:
+        /// @param alpha Weight of the new input in (0, 1], smaller is smoother.
+        EMAFilter (const Number alpha)
+        : alpha(alpha)
+        {}
+
+        Number update (const Number input)
+        {
+            if (!initialized) {
+                value = input;
+                initialized = true;
+            } else {
+                value += (input - value) * alpha;
+            }
+            return value;
+        }
+
+        Number get () const
+        {
+            return value;
+        }
+};
+
+/// @brief Alpha-beta filter, tracks a value and its rate with a constant rate model.
+template <typename Number = double>
+class AlphaBetaFilter
+{
+    private:
+        const Number alpha, beta;
+        Number value = 0, rate = 0;
+        bool initialized = false;
+
+    public:
+        AlphaBetaFilter (const Number alpha, const Number beta)
+        : alpha(alpha),
+          beta(beta)
+        {}
+
+        /// @param dt Time since the previous measurement.
+        Number update (const Number measurement, const Number dt)
+        {
+            if (!initialized) {
+                value = measurement;
+                initialized = true;
+                return value;
+            }
+
+            const Number predicted = value + rate * dt;
+            const Number residual = measurement - predicted;
+            value = predicted + residual * alpha;
+            rate += residual * beta / dt;
+            return value;
+        }
+
+        Number get () const
+        {
+            return value;
+        }
+
+        Number get_rate () const
+        {
+            return rate;
+        }
+};
+
+/// @brief Kalman filter of a single slowly changing value, a random walk measured with noise.
+class KalmanFilter
+{
+    private:
+        // variances of the change between updates and of the measurement noise
+        const double process_noise, measurement_noise;
+        double value = 0;
+        double variance;
+
+    public:
+        KalmanFilter (const double process_noise, const double measurement_noise, const double initial_variance = 1e6)
+        : process_noise(process_noise),
+          measurement_noise(measurement_noise),
+          variance(initial_variance)
+        {}
+
+        double update (const double measurement)
+        {
+            variance += process_noise;
+            const double gain = variance / (variance + measurement_noise);
+            value += gain * (measurement - value);
+            variance *= 1 - gain;
+            return value;
+        }
+
+        double get () const
+        {
+            return value;
+        }
+
+        double get_variance () const
+        {
+            return variance;
+        }
+};
+
+/// @brief Derivative as the slope of a least squares line through the last size values, sampled at equal intervals.
+/// Less noisy than a difference of two samples, with a delay of half the window.
+template <typename Number, size_t size>
+class DerivativeFilter
+{
+    static_assert(size >= 2, "DerivativeFilter - needs at least two values");
+
+    private:
+        RingBuffer<Number, size> buffer;
+
+    public:
+        /// @param dt Interval of the samples.
+        Number update (const Number value, const Number dt)
+        {
+            buffer.push(value);
+            const int count = buffer.get_count();
+            if (count < 2) {
+                return 0;
+            }
+
+            // with centered sample indices the slope is sum(i * x) / sum(i^2), doubled to stay in integers
+            Number numerator = 0;
+            int denominator = 0;
+            for (int index = 0; index < count; index++) {
+                const int centered = 2 * index - (count - 1);
+                numerator += buffer[index] * centered;
+                denominator += centered * centered;
+            }
+            return numerator * 2 / denominator / dt;
+        }
+};
+
+} // namespace
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
+namespace FRT
+{
+
+/// @brief Signed 32 bit fixed-point number, for control math on targets without a hardware FPU.
+/// Products of different formats take the format of the left operand, so gains can have finer resolution than signals.
+/// @tparam fraction_bits Number of fractional bits, the range is +-2^(31 - fraction_bits).
+template <int fraction_bits = 16>
+class Fixed
+{
+    static_assert(fraction_bits > 0 && fraction_bits < 31, "Fixed - invalid number of fraction bits");
+
+    public:
+        using storage_type = int32_t;
+        using intermediate_type = int64_t;
+
+        static constexpr int bits = fraction_bits;
+        static constexpr storage_type one = storage_type(1) << fraction_bits;
+
+        storage_type raw = 0;
+
+        static constexpr Fixed from_raw (const storage_type raw)
+        {
+            Fixed result;
+            result.raw = raw;
+            return result;
+        }
+
+        constexpr Fixed () = default;
+
+        constexpr Fixed (const int value)
+        : raw(value * one)
+        {}
+
+        constexpr Fixed (const double value)
+        : raw(storage_type(value * one + (value >= 0 ? 0.5 : -0.5)))
+        {}
+
+        template <int other_bits>
+        constexpr explicit Fixed (const Fixed<other_bits> other)
+        {
+            if constexpr (other_bits > fraction_bits) {
+                raw = other.raw >> (other_bits - fraction_bits);
+            } else {
+                raw = other.raw << (fraction_bits - other_bits);
+            }
+        }
+
+        /// @brief Truncates toward zero, like the conversion of double.
+        constexpr explicit operator int () const
+        {
+            return raw / one;
+        }
+
+        constexpr explicit operator double () const
+        {
+            return (double)raw / one;
+        }
+
+        constexpr auto operator<=> (const Fixed &) const = default;
+
+        friend constexpr Fixed operator+ (const Fixed lhs, const Fixed rhs)
+        {
+            return from_raw(lhs.raw + rhs.raw);
+        }
+
+        friend constexpr Fixed operator- (const Fixed lhs, const Fixed rhs)
+        {
+            return from_raw(lhs.raw - rhs.raw);
+        }
+
+        constexpr Fixed operator- () const
+        {
+            return from_raw(-raw);
+        }
+
+        template <int other_bits>
+        friend constexpr Fixed operator* (const Fixed lhs, const Fixed<other_bits> rhs)
+        {
+            return from_raw(storage_type(((intermediate_type)lhs.raw * rhs.raw) >> other_bits));
+        }
+
+        friend constexpr Fixed operator* (const Fixed lhs, const int rhs)
+        {
+            return from_raw(lhs.raw * rhs);
+        }
+
+        friend constexpr Fixed operator* (const int lhs, const Fixed rhs)
+        {
+            return from_raw(lhs * rhs.raw);
+        }
+
+        template <int other_bits>
+        friend constexpr Fixed operator/ (const Fixed lhs, const Fixed<other_bits> rhs)
+        {
+            return from_raw(storage_type(((intermediate_type)lhs.raw << other_bits) / rhs.raw));
+        }
+
+        friend constexpr Fixed operator/ (const Fixed lhs, const int rhs)
+        {
+            return from_raw(lhs.raw / rhs);
+        }
+
+        constexpr Fixed &operator+= (const Fixed rhs)
+        {
+            raw += rhs.raw;
+            return *this;
+        }
+
+        constexpr Fixed &operator-= (const Fixed rhs)
+        {
+            raw -= rhs.raw;
+            return *this;
+        }
+
+        friend constexpr Fixed abs (const Fixed value)
+        {
+            return value.raw < 0 ? -value : value;
+        }
+
+        friend std::ostream &operator<< (std::ostream &stream, const Fixed value)
+        {
+            return stream << (double)value;
+        }
+};
+
+template <typename T>
+struct is_fixed : std::false_type {};
+
+template <int fraction_bits>
+struct is_fixed<Fixed<fraction_bits>> : std::true_type {};
+
+/// @brief Gain type for a given signal type: the same floating point type, or a fixed-point format with the given resolution.
+template <typename Number, int fraction_bits>
+using GainType = std::conditional_t<std::is_floating_point_v<Number>, Number, Fixed<fraction_bits>>;
+
+} // namespace
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+
+namespace FRT
+{
+
+/// @brief A value read from a device, tagged whether it is a new sample or a repeat of the previous one.
+template <typename T>
+struct Reading
+{
+    using clock = std::chrono::steady_clock;
+
+    T value;
+    bool fresh;
+    // when the sample was first seen
+    clock::time_point time;
+};
+
+/// @brief Tells new samples from repeats of attributes that are read faster than the device updates them.
+/// A sample is new if its value changed, or if a whole sample period passed, so constant signals are not stuck as repeats.
+template <typename T>
+class FreshnessTracker
+{
+    public:
+        using clock = std::chrono::steady_clock;
+
+    private:
+        T last {};
+        clock::time_point last_time = clock::time_point::min();
+        clock::duration period;
+        bool initialized = false;
+
+    public:
+        /// @param period Update period of the device, zero if unknown, then only value changes count.
+        FreshnessTracker (const clock::duration period = clock::duration::zero())
+        : period(period)
+        {}
+
+        Reading<T> update (const T &value, const clock::time_point now = clock::now())
+        {
+            const bool fresh = !initialized || value != last || (period > clock::duration::zero() && now - last_time >= period);
+            if (fresh) {
+                last = value;
+                last_time = now;
+                initialized = true;
+            }
+            return Reading<T> { value, fresh, last_time };
+        }
+
+        void set_period (const clock::duration value)
+        {
+            period = value;
+        }
+
+        /// @brief Forgets the last sample, e.g. after a mode switch, the next one is new.
+        void reset ()
+        {
+            initialized = false;
+        }
+};
+
+} // namespace
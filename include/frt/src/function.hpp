@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace FRT
+{
+
+template <typename Signature, size_t capacity = 4 * sizeof(void *)>
+class InplaceFunction;
+
+/// @brief Move-only std::function replacement that stores the callable inside the object and never allocates.
+/// Callables that do not fit into the capacity are rejected at compile time.
+template <typename Result, typename... Args, size_t capacity>
+class InplaceFunction<Result(Args...), capacity>
+{
+    private:
+        enum class operation
+        {
+            move,
+            destroy,
+        };
+
+        alignas(std::max_align_t) unsigned char storage[capacity];
+        Result (*invoker)(void *, Args...) = nullptr;
+        void (*manager)(operation, void *, void *) = nullptr;
+
+        template <typename Callable>
+        static Result invoke (void *callable, Args... args)
+        {
+            return (*static_cast<Callable *>(callable))(std::forward<Args>(args)...);
+        }
+
+        template <typename Callable>
+        static void manage (const operation op, void *destination, void *source)
+        {
+            switch (op) {
+                case operation::move:
+                    new (destination) Callable(std::move(*static_cast<Callable *>(source)));
+                    static_cast<Callable *>(source)->~Callable();
+                    break;
+                case operation::destroy:
+                    static_cast<Callable *>(destination)->~Callable();
+                    break;
+            }
+        }
+
+    public:
+        InplaceFunction () = default;
+
+        template <typename Callable>
+        requires (!std::is_same_v<std::decay_t<Callable>, InplaceFunction> && std::is_invocable_r_v<Result, std::decay_t<Callable> &, Args...>)
+        InplaceFunction (Callable &&callable)
+        {
+            using Stored = std::decay_t<Callable>;
+            static_assert(sizeof(Stored) <= capacity, "InplaceFunction - callable does not fit, increase the capacity");
+            static_assert(alignof(Stored) <= alignof(std::max_align_t), "InplaceFunction - callable is overaligned");
+
+            new (storage) Stored(std::forward<Callable>(callable));
+            invoker = &invoke<Stored>;
+            manager = &manage<Stored>;
+        }
+
+        InplaceFunction (InplaceFunction &&other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        InplaceFunction &operator= (InplaceFunction &&other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                if (other.manager) {
+                    other.manager(operation::move, storage, other.storage);
+                    invoker = other.invoker;
+                    manager = other.manager;
+                    other.invoker = nullptr;
+                    other.manager = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        InplaceFunction (const InplaceFunction &) = delete;
+        InplaceFunction &operator= (const InplaceFunction &) = delete;
+
+        ~InplaceFunction ()
+        {
+            reset();
+        }
+
+        void reset ()
+        {
+            if (manager) {
+                manager(operation::destroy, storage, nullptr);
+                invoker = nullptr;
+                manager = nullptr;
+            }
+        }
+
+        explicit operator bool () const
+        {
+            return invoker != nullptr;
+        }
+
+        Result operator() (Args... args)
+        {
+            return invoker(storage, std::forward<Args>(args)...);
+        }
+};
+
+} // namespace
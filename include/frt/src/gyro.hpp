@@ -0,0 +1,248 @@
+#pragma once
+
+#include "function.hpp"
+#include "logger.hpp"
+#include "sensor.hpp"
+#include "utility.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace FRT
+{
+
+struct DriftStatistics
+{
+    // current bias estimate in degrees per second
+    double bias = 0;
+    // bias at the end of the calibration, the difference to it is the drift of the bias
+    double initial_bias = 0;
+    double min_bias = 0, max_bias = 0;
+    // heading error that would have accumulated without the bias compensation, in degrees
+    double compensated = 0;
+    // seconds spent standing still and in total
+    double stationary_time = 0;
+    double total_time = 0;
+    uint32_t updates = 0;
+    // updates that read a new sample, the rest repeated the previous one, held as the rate meanwhile
+    uint32_t new_samples = 0;
+};
+
+/// @brief Heading from the raw rate of the gyro (GYRO-FAS), integrated on a background thread at a high rate.
+/// The bias is estimated whenever the robot stands still, and the heading is held meanwhile,
+/// so it stays accurate over long runs without resetting it to hide drift.
+/// Once started, the gyro must not be read directly, since that would switch it out of the fast mode.
+class GyroProcessor
+{
+    public:
+        using clock = std::chrono::steady_clock;
+
+    private:
+        GyroSensor &gyro;
+        // tells whether the robot stands still, e.g. from the wheel encoders, called on the background thread
+        InplaceFunction<bool()> is_stationary;
+        // degrees per second per raw unit
+        const double rate_scale;
+        const clock::duration period;
+
+        // standing still for this long lets vibrations settle before the bias is learned
+        static constexpr double settle_time = 0.1;
+        // time constant of the bias estimate in seconds
+        static constexpr double bias_time_constant = 1;
+        // a rate this large in degrees per second means the robot is moved, even if its wheels do not turn
+        static constexpr double motion_threshold = 3;
+
+        // state of the background thread
+        double heading = 0;
+        double bias = 0;
+        double stationary_for = 0;
+        DriftStatistics statistics;
+
+        // published to the other threads, 32 bit values are lock-free on the EV3 too
+        std::atomic<float> published_heading = 0;
+        std::atomic<float> published_rate = 0;
+        std::atomic<float> reset_heading = 0;
+        std::atomic<bool> reset_requested = false;
+        std::atomic<bool> log_requested = false;
+        std::atomic<bool> running = false;
+        std::thread thread;
+
+        void update (const double dt)
+        {
+            const auto reading = gyro.get_raw_rate_reading();
+            const double raw = reading.value * rate_scale;
+            double rate = raw - bias;
+
+            statistics.updates++;
+            statistics.total_time += dt;
+
+            if (std::abs(rate) < motion_threshold && is_stationary()) {
+                stationary_for += dt;
+                statistics.stationary_time += dt;
+                if (stationary_for >= settle_time) {
+                    bias += (raw - bias) * dt / (bias_time_constant + dt);
+                    statistics.min_bias = std::min(statistics.min_bias, bias);
+                    statistics.max_bias = std::max(statistics.max_bias, bias);
+                }
+                // zero velocity update: the heading does not change while standing still
+                rate = 0;
+            } else {
+                stationary_for = 0;
+            }
+
+            if (reading.fresh) {
+                statistics.new_samples++;
+            }
+
+            heading += rate * dt;
+            statistics.compensated += (raw - rate) * dt;
+            statistics.bias = bias;
+
+            const bool resetting = reset_requested.load(std::memory_order_acquire);
+            if (resetting) {
+                heading = reset_heading.load(std::memory_order_relaxed);
+            }
+            published_heading.store(heading, std::memory_order_release);
+            published_rate.store(rate, std::memory_order_release);
+            if (resetting) {
+                reset_requested.store(false, std::memory_order_release);
+            }
+
+            if (log_requested.exchange(false, std::memory_order_relaxed)) {
+                print_statistics();
+            }
+        }
+
+        void print_statistics () const
+        {
+            Logger::info("GyroProcessor - bias:", statistics.bias,
+                "drift since calibration:", statistics.bias - statistics.initial_bias,
+                "range:", statistics.min_bias, statistics.max_bias,
+                "compensated deg:", statistics.compensated,
+                "stationary:", statistics.stationary_time, "/", statistics.total_time, "s",
+                "updates:", statistics.updates,
+                "new samples:", statistics.new_samples);
+        }
+
+        void loop ()
+        {
+            auto last = clock::now();
+            auto next = last;
+            while (running.load(std::memory_order_relaxed)) {
+                next += period;
+                std::this_thread::sleep_until(next);
+
+                const auto now = clock::now();
+                update(std::chrono::duration<double>(now - last).count());
+                last = now;
+
+                // not catching up after a stall, that would only burst sysfs reads
+                if (now - next > period) {
+                    next = now;
+                }
+            }
+        }
+
+    public:
+        /// @param rate_scale Degrees per second per raw unit of GYRO-FAS.
+        /// @param period Interval of the integration.
+        template <typename Stationary>
+        GyroProcessor (GyroSensor &gyro, Stationary &&is_stationary, const double rate_scale = 1, const clock::duration period = std::chrono::milliseconds(2))
+        : gyro(gyro),
+          is_stationary(std::forward<Stationary>(is_stationary)),
+          rate_scale(rate_scale),
+          period(period)
+        {}
+
+        GyroProcessor (const GyroProcessor &) = delete;
+
+        ~GyroProcessor ()
+        {
+            stop();
+        }
+
+        /// @brief Measures the initial bias, the robot has to stand still meanwhile. Only before GyroProcessor::start.
+        void calibrate (const auto duration)
+        {
+            const auto end = clock::now() + duration;
+            double sum = 0;
+            int count = 0;
+            while (clock::now() < end) {
+                sum += gyro.get_raw_rate() * rate_scale;
+                count++;
+                sleep(period);
+            }
+            bias = count ? sum / count : 0;
+            statistics = DriftStatistics {};
+            statistics.bias = statistics.initial_bias = statistics.min_bias = statistics.max_bias = bias;
+            Logger::info("GyroProcessor::calibrate - bias", bias, "deg/s from", count, "samples");
+        }
+
+        void start ()
+        {
+            if (running.exchange(true)) {
+                return;
+            }
+            thread = std::thread(&GyroProcessor::loop, this);
+        }
+
+        void stop ()
+        {
+            if (running.exchange(false)) {
+                thread.join();
+            }
+        }
+
+        deg get_heading () const
+        {
+            return deg(published_heading.load(std::memory_order_acquire));
+        }
+
+        /// @brief Bias compensated rate in degrees per second.
+        deg get_rate () const
+        {
+            return deg(published_rate.load(std::memory_order_acquire));
+        }
+
+        GyroSensor::AngleAndRate get_heading_and_rate () const
+        {
+            return GyroSensor::AngleAndRate { get_heading(), get_rate() };
+        }
+
+        /// @brief Makes the current heading the given one, e.g. after aligning to a wall.
+        void reset (const deg heading = 0)
+        {
+            if (!running.load(std::memory_order_relaxed)) {
+                this->heading = heading.value;
+                published_heading.store(heading.value, std::memory_order_release);
+                return;
+            }
+
+            // applied by the next update, waiting for it so the following reads see the new heading
+            reset_heading.store(heading.value, std::memory_order_relaxed);
+            reset_requested.store(true, std::memory_order_release);
+            while (reset_requested.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+
+        /// @brief Consistent only while the processor is stopped.
+        const DriftStatistics &get_statistics () const
+        {
+            return statistics;
+        }
+
+        /// @brief Logs the drift statistics, from the background thread while it runs.
+        void log_statistics ()
+        {
+            if (running.load(std::memory_order_relaxed)) {
+                log_requested.store(true, std::memory_order_relaxed);
+            } else {
+                print_statistics();
+            }
+        }
+};
+
+} // namespace
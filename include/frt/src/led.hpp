@@ -2,6 +2,11 @@
 
 #include "device.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
 namespace FRT
 {
 
@@ -10,19 +15,28 @@ class LEDInterface : public Device
     public:
         using Device::Device;
 
-        File brightness = attribute("brightness");
-        File max_brightness = attribute("max_brightness");
-        File trigger = attribute("trigger");
-        File delay_on = attribute("delay_on");
-        File delay_off = attribute("delay_off");
+        // written by the thread of the status lights while they run, by one thread at a time otherwise
+        UnlockedFile brightness = attribute<UnlockedFile>("brightness");
+        UnlockedFile max_brightness = attribute<UnlockedFile>("max_brightness");
+        UnlockedFile trigger = attribute<UnlockedFile>("trigger");
+        UnlockedFile delay_on = attribute<UnlockedFile>("delay_on");
+        UnlockedFile delay_off = attribute<UnlockedFile>("delay_off");
 };
 
+/// @brief The brick status LEDs. Writes that would not change the state are skipped, so setting a color every tick is cheap.
 class LED
 {
+    friend class StatusLights;
+
     struct LEDColor
     {
         LEDInterface attributes;
 
+        // last written values, unknown at first
+        int brightness = -1;
+        std::string trigger = "";
+        int delay_on = -1, delay_off = -1;
+
         LEDColor (const std::string &path)
         : attributes(path)
         {}
@@ -37,9 +51,12 @@ class LED
             return attributes.brightness.read<int>();
         }
 
-        void set_brightness (const int brightness)
+        void set_brightness (const int value)
         {
-            attributes.brightness.write(brightness);
+            if (value != brightness) {
+                attributes.brightness.write(value);
+                brightness = value;
+            }
         }
 
         std::vector<std::string> get_supported_triggers ()
@@ -47,9 +64,14 @@ class LED
             return attributes.trigger.read<std::vector<std::string>>();
         }
 
-        void set_trigger (const std::string_view trigger)
+        void set_trigger (const std::string_view value)
         {
-            attributes.trigger.write(trigger);
+            if (value != trigger) {
+                attributes.trigger.write(value);
+                trigger = value;
+                // the kernel turns the LED off and recreates the delays on a trigger change
+                brightness = delay_on = delay_off = -1;
+            }
         }
 
         int get_delay_on ()
@@ -57,9 +79,12 @@ class LED
             return attributes.delay_on.read<int>();
         }
 
-        void set_delay_on (const int delay_on)
+        void set_delay_on (const int value)
         {
-            attributes.delay_on.write(delay_on);
+            if (value != delay_on) {
+                attributes.delay_on.write(value);
+                delay_on = value;
+            }
         }
 
         int get_delay_off ()
@@ -67,9 +92,27 @@ class LED
             return attributes.delay_off.read<int>();
         }
 
-        void set_delay_off (const int delay_off)
+        void set_delay_off (const int value)
+        {
+            if (value != delay_off) {
+                attributes.delay_off.write(value);
+                delay_off = value;
+            }
+        }
+
+        /// @brief Constant brightness, 0 is off.
+        void set_steady (const int value)
         {
-            attributes.delay_off.write(delay_off);
+            set_trigger("none");
+            set_brightness(value);
+        }
+
+        /// @brief Blinking timed by the kernel, without any further writes.
+        void blink (const int on_ms, const int off_ms)
+        {
+            set_trigger("timer");
+            set_delay_on(on_ms);
+            set_delay_off(off_ms);
         }
     };
 
@@ -81,4 +124,116 @@ class LED
         
 };
 
+struct LEDPattern
+{
+    bool red = false, green = false;
+    // off_ms of zero is steady light
+    uint16_t on_ms = 0, off_ms = 0;
+};
+
+/// @brief Shows states, e.g. the mission phase or an error, on both LEDs.
+/// StatusLights::show only stores the pattern, a background thread applies the latest one,
+/// so the control loop never waits for the LED files and quick changes are coalesced.
+class StatusLights
+{
+    public:
+        struct patterns
+        {
+            static constexpr LEDPattern off = {};
+            static constexpr LEDPattern busy = { true, true, 0, 0 };
+            static constexpr LEDPattern ready = { false, true, 0, 0 };
+            static constexpr LEDPattern running = { false, true, 500, 500 };
+            static constexpr LEDPattern error = { true, false, 100, 100 };
+        };
+
+    private:
+        LED &led;
+        const std::chrono::milliseconds period;
+
+        // the pattern packed into a word, 32 bit atomics are lock-free on the EV3 too
+        std::atomic<uint32_t> requested = 0;
+        uint32_t applied = ~0u;
+        std::atomic<bool> running = false;
+        std::thread thread;
+
+        static uint32_t pack (const LEDPattern &pattern)
+        {
+            return (uint32_t)pattern.red | (uint32_t)pattern.green << 1 | (uint32_t)(pattern.on_ms & 0x7fff) << 2 | (uint32_t)(pattern.off_ms & 0x7fff) << 17;
+        }
+
+        static LEDPattern unpack (const uint32_t packed)
+        {
+            return LEDPattern { (packed & 1) != 0, (packed & 2) != 0, (uint16_t)(packed >> 2 & 0x7fff), (uint16_t)(packed >> 17 & 0x7fff) };
+        }
+
+        static void apply (LED::LEDColor &color, const bool lit, const LEDPattern &pattern)
+        {
+            if (lit && pattern.off_ms > 0) {
+                color.blink(pattern.on_ms, pattern.off_ms);
+            } else {
+                color.set_steady(lit ? 255 : 0);
+            }
+        }
+
+        void update ()
+        {
+            const uint32_t packed = requested.load(std::memory_order_relaxed);
+            if (packed == applied) {
+                return;
+            }
+            applied = packed;
+
+            const LEDPattern pattern = unpack(packed);
+            apply(led.red_left, pattern.red, pattern);
+            apply(led.red_right, pattern.red, pattern);
+            apply(led.green_left, pattern.green, pattern);
+            apply(led.green_right, pattern.green, pattern);
+        }
+
+        void loop ()
+        {
+            while (running.load(std::memory_order_relaxed)) {
+                update();
+                std::this_thread::sleep_for(period);
+            }
+            // the last pattern is shown even if it came right before stopping
+            update();
+        }
+
+    public:
+        /// @param period Interval of checking for a new pattern.
+        StatusLights (LED &led, const std::chrono::milliseconds period = std::chrono::milliseconds(50))
+        : led(led),
+          period(period)
+        {}
+
+        StatusLights (const StatusLights &) = delete;
+
+        ~StatusLights ()
+        {
+            stop();
+        }
+
+        void start ()
+        {
+            if (running.exchange(true)) {
+                return;
+            }
+            thread = std::thread(&StatusLights::loop, this);
+        }
+
+        void stop ()
+        {
+            if (running.exchange(false)) {
+                thread.join();
+            }
+        }
+
+        /// @brief Shows the pattern from the next update on, callable from any thread at any rate.
+        void show (const LEDPattern &pattern)
+        {
+            requested.store(pack(pattern), std::memory_order_relaxed);
+        }
+};
+
 } // namespace
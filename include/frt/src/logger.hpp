@@ -3,6 +3,7 @@
 #include "config.hpp"
 #include "sound.hpp"
 
+#include <atomic>
 #include <iostream>
 #include <iomanip>
 #include <ctime>
@@ -57,6 +58,37 @@ std::ostream &operator<< (std::ostream &stream, const C &container)
     return stream << " }"; 
 }
 
+/// @brief Beeps for errors at most once per interval, queued to the sound thread,
+/// so an error costs the caller an atomic increment instead of waiting for the beep.
+class ErrorSignal
+{
+    private:
+        static constexpr uint32_t interval_ms = 500;
+
+        static inline std::atomic<uint32_t> raised = 0;
+        // wrapping millisecond time of the last beep, 32 bit atomics are lock-free on the EV3 too
+        static inline std::atomic<uint32_t> last_beep = 0;
+
+    public:
+        static void raise ()
+        {
+            using namespace std::chrono;
+            const bool first = raised.fetch_add(1, std::memory_order_relaxed) == 0;
+
+            const uint32_t now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+            uint32_t last = last_beep.load(std::memory_order_relaxed);
+            if ((first || now - last >= interval_ms) && last_beep.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+                Sound::beep<true>(1000, 200);
+            }
+        }
+
+        /// @brief Number of errors so far.
+        static uint32_t count ()
+        {
+            return raised.load(std::memory_order_relaxed);
+        }
+};
+
 class Logger 
 {
     public:
@@ -70,7 +102,7 @@ class Logger
                 print(args...);
             }
             if constexpr (beep_on_error) {
-                Sound::beep(1000, 200);
+                ErrorSignal::raise();
             }
         }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "coroutine.hpp"
 #include "device.hpp"
 
 namespace FRT
@@ -10,33 +11,35 @@ class TachoMotorInterface : public Device
     public:
         using Device::Device;
 
-        File address = attribute("address");
+        // command, state and speed are used by other threads too: the watchdog stops the motor and checks whether it runs,
+        // the gyro processor reads the speed. The rest belongs to the thread driving the motor
+        ConfinedFile address = attribute<ConfinedFile>("address");
         File command = attribute("command");
-        File commands = attribute("commands");
-        File count_per_rot = attribute("count_per_rot");
-        File count_per_m = attribute("count_per_m");
-        File full_travel_count = attribute("full_travel_count");
-        File driver_name = attribute("driver_name");
-        File duty_cycle = attribute("duty_cycle");
-        File duty_cycle_sp = attribute("duty_cycle_sp");
-        File polarity = attribute("polarity");
-        File position = attribute("position");
-        File hold_pid_kd = attribute("hold_pid/Kd");
-        File hold_pid_ki = attribute("hold_pid/Ki");
-        File hold_pid_kp = attribute("hold_pid/Kp");
-        File max_speed = attribute("max_speed");
-        File position_sp = attribute("position_sp");
+        ConfinedFile commands = attribute<ConfinedFile>("commands");
+        ConfinedFile count_per_rot = attribute<ConfinedFile>("count_per_rot");
+        ConfinedFile count_per_m = attribute<ConfinedFile>("count_per_m");
+        ConfinedFile full_travel_count = attribute<ConfinedFile>("full_travel_count");
+        ConfinedFile driver_name = attribute<ConfinedFile>("driver_name");
+        ConfinedFile duty_cycle = attribute<ConfinedFile>("duty_cycle");
+        ConfinedFile duty_cycle_sp = attribute<ConfinedFile>("duty_cycle_sp");
+        ConfinedFile polarity = attribute<ConfinedFile>("polarity");
+        ConfinedFile position = attribute<ConfinedFile>("position");
+        ConfinedFile hold_pid_kd = attribute<ConfinedFile>("hold_pid/Kd");
+        ConfinedFile hold_pid_ki = attribute<ConfinedFile>("hold_pid/Ki");
+        ConfinedFile hold_pid_kp = attribute<ConfinedFile>("hold_pid/Kp");
+        ConfinedFile max_speed = attribute<ConfinedFile>("max_speed");
+        ConfinedFile position_sp = attribute<ConfinedFile>("position_sp");
         File speed = attribute("speed");
-        File speed_sp = attribute("speed_sp");
-        File ramp_up_sp = attribute("ramp_up_sp");
-        File ramp_down_sp = attribute("ramp_down_sp");
-        File speed_pid_kd = attribute("speed_pid/Kd");
-        File speed_pid_ki = attribute("speed_pid/Ki");
-        File speed_pid_kp = attribute("speed_pid/Kp");
+        ConfinedFile speed_sp = attribute<ConfinedFile>("speed_sp");
+        ConfinedFile ramp_up_sp = attribute<ConfinedFile>("ramp_up_sp");
+        ConfinedFile ramp_down_sp = attribute<ConfinedFile>("ramp_down_sp");
+        ConfinedFile speed_pid_kd = attribute<ConfinedFile>("speed_pid/Kd");
+        ConfinedFile speed_pid_ki = attribute<ConfinedFile>("speed_pid/Ki");
+        ConfinedFile speed_pid_kp = attribute<ConfinedFile>("speed_pid/Kp");
         File state = attribute("state");
-        File stop_action = attribute("stop_action");
-        File stop_actions = attribute("stop_actions");
-        File time_sp = attribute("time_sp");
+        ConfinedFile stop_action = attribute<ConfinedFile>("stop_action");
+        ConfinedFile stop_actions = attribute<ConfinedFile>("stop_actions");
+        ConfinedFile time_sp = attribute<ConfinedFile>("time_sp");
 };
 
 class TachoMotor
@@ -97,6 +100,10 @@ class TachoMotor
         const int max_speed;
         const std::vector<std::string> supported_stop_actions;
 
+        // conversion multipliers precomputed from the geometry
+        const double radians_per_pulse;
+        const double meters_per_pulse;
+
         TachoMotor (const std::string_view port, const Unit auto &diameter, const bool reset = true) 
         :   attributes("tacho-motor/", port),
             diameter(length_cast<m>(diameter)),
@@ -105,7 +112,9 @@ class TachoMotor
             pulses_per_rotation(attributes.count_per_rot.read<int>()),
             driver_name(attributes.driver_name.read<std::string>()),
             max_speed(attributes.max_speed.read<int>()),
-            supported_stop_actions(attributes.stop_actions.read<std::vector<std::string>>())
+            supported_stop_actions(attributes.stop_actions.read<std::vector<std::string>>()),
+            radians_per_pulse(FRT::radians_per_pulse(pulses_per_rotation)),
+            meters_per_pulse(FRT::meters_per_pulse(this->diameter, pulses_per_rotation))
         {
             if (!reset) return;
             TachoMotor::reset();
@@ -116,17 +125,27 @@ class TachoMotor
             double position_coefficient = 1;
         } config;
 
+        /// @returns The multiplier converting pulses to the given unit.
+        template <Unit To>
+        constexpr double units_per_pulse () const
+        {
+            if constexpr (Angle<To>) {
+                return radians_per_pulse * config.position_coefficient * conversion_factor<To, rad>;
+            } else {
+                return meters_per_pulse * config.position_coefficient * conversion_factor<To, m>;
+            }
+        }
+
         template <Unit To>
         constexpr To pulses_to_units (const double pulses)
         {
-            const auto value = FRT::pulses_to_units<To>(pulses, diameter, pulses_per_rotation);
-            return value * config.position_coefficient;
+            return To(pulses * units_per_pulse<To>());
         }
 
         constexpr int units_to_pulses (const Unit auto &value)
         {
-            const auto pulses = FRT::units_to_pulses(value, diameter, pulses_per_rotation);
-            return round(pulses / config.position_coefficient);
+            using From = std::remove_cvref_t<decltype(value)>;
+            return round(value.value / units_per_pulse<From>());
         }
 
         void run_command (const std::string_view command) 
@@ -259,6 +278,12 @@ class TachoMotor
             }
         }
 
+        /// @returns Raw encoder count, without any unit conversion.
+        int get_position_pulses ()
+        {
+            return attributes.position.read<int>();
+        }
+
         template <Unit Unit = cm>
         Unit get_position ()
         {
@@ -272,6 +297,12 @@ class TachoMotor
             attributes.position.write(pulses);
         }
 
+        /// @returns Raw speed in encoder pulses per second, without any unit conversion.
+        int get_speed_pulses ()
+        {
+            return attributes.speed.read<int>();
+        }
+
         template <Unit Unit = cm>
         Unit get_speed ()
         {
@@ -378,6 +409,18 @@ class TachoMotor
             }
         }
 
+        /// @brief Awaitable for coroutines run by an FRT::EventLoop, completes once the motor stalls.
+        auto until_stalled ()
+        {
+            return until([this] { return is_stalled(); }, attributes.state);
+        }
+
+        /// @brief Awaitable for coroutines run by an FRT::EventLoop, completes once the motor is not running anymore.
+        auto until_stopped ()
+        {
+            return until([this] { return !is_running(); }, attributes.state);
+        }
+
         template <bool block = false>
         void on (const Unit auto &velocity)
         {
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "logger.hpp"
+#include "motor.hpp"
+#include "utility.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace FRT
+{
+
+/// @brief Steady state model of a motor under load: the duty cycle needed for a speed, as a small lookup table.
+/// Used as feedforward, so speed loops only have to correct the residual.
+struct MotorModel
+{
+    static constexpr int points = 11;
+    static constexpr int duty_step = 100 / (points - 1);
+
+    // lowest duty cycle starting the motor from rest
+    int16_t static_friction = 0;
+    // lowest duty cycle keeping it running
+    int16_t deadband = 0;
+    // steady state speed in pulses per second at duty cycles 0, duty_step, ..., 100
+    std::array<int16_t, points> speeds {};
+
+    bool valid () const
+    {
+        return speeds.back() > 0;
+    }
+
+    /// @brief Duty cycle for a speed, linearly interpolated in the table.
+    /// @param moving Whether the motor runs already, otherwise at least the static friction is needed to start it.
+    int duty_for (const int speed, const bool moving) const
+    {
+        if (!valid() || speed == 0) {
+            return 0;
+        }
+
+        const int magnitude = std::abs(speed);
+        int duty = 100;
+        for (int index = 1; index < points; index++) {
+            if (magnitude <= speeds[index]) {
+                const int low = speeds[index - 1], high = speeds[index];
+                duty = (index - 1) * duty_step + (high > low ? (magnitude - low) * duty_step / (high - low) : 0);
+                break;
+            }
+        }
+
+        duty = std::max<int>(duty, moving ? deadband : static_friction);
+        return speed > 0 ? duty : -duty;
+    }
+
+    /// @brief Reads the model of the motor with the given index from a file written by MotorModel::save.
+    /// @returns An invalid model if there is none, the controllers fall back to feedback only.
+    static MotorModel load (const std::string_view path, const int index)
+    {
+        MotorModel model;
+        std::ifstream file(std::string(path), std::ios::binary);
+        file.seekg(index * sizeof(MotorModel));
+        if (!file.read(reinterpret_cast<char *>(&model), sizeof(MotorModel))) {
+            Logger::warning("MotorModel::load - no model", index, "in", path);
+            return MotorModel {};
+        }
+        return model;
+    }
+
+    template <size_t count>
+    static bool save (const std::string_view path, const std::array<MotorModel, count> &models)
+    {
+        std::ofstream file(std::string(path), std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char *>(models.data()), count * sizeof(MotorModel))) {
+            Logger::error("MotorModel::save - cannot write", path);
+            return false;
+        }
+        return true;
+    }
+
+    friend std::ostream &operator<< (std::ostream &stream, const MotorModel &model)
+    {
+        stream << "static friction: " << model.static_friction << " deadband: " << model.deadband << " speeds:";
+        for (const auto speed : model.speeds) {
+            stream << " " << speed;
+        }
+        return stream;
+    }
+};
+
+/// @brief Identifies the models of motors driven together, e.g. the wheels of a robot.
+/// Every duty cycle is run forward and backward for the same time, so the robot ends up roughly where it started.
+template <typename... Motors>
+inline std::array<MotorModel, sizeof...(Motors)> identify_motor_models (Motors &...motor_references)
+{
+    constexpr size_t count = sizeof...(Motors);
+    std::array<TachoMotor *, count> motors { &motor_references... };
+    std::array<MotorModel, count> models {};
+
+    const auto drive = [&] (const int duty) {
+        for (auto motor : motors) {
+            motor->set_duty_cycle_setpoint(duty);
+        }
+    };
+    const auto speed_of = [&] (const size_t index) {
+        return std::abs(motors[index]->get_speed_pulses());
+    };
+
+    drive(0);
+    for (auto motor : motors) {
+        motor->run_direct();
+    }
+
+    // static friction: raising the duty cycle from rest until the motor starts
+    for (int direction : { 1, -1 }) {
+        std::array<bool, count> started {};
+        for (int duty = 1; duty <= 100; duty++) {
+            drive(duty * direction);
+            sleep(50ms);
+            bool all = true;
+            for (size_t index = 0; index < count; index++) {
+                if (!started[index] && speed_of(index) > 0) {
+                    started[index] = true;
+                    // the slower direction counts
+                    models[index].static_friction = std::max<int16_t>(models[index].static_friction, duty);
+                }
+                all &= started[index];
+            }
+            if (all) {
+                break;
+            }
+        }
+        drive(0);
+        sleep(300ms);
+    }
+
+    // steady state speeds, averaging both directions
+    for (int point = 1; point < MotorModel::points; point++) {
+        const int duty = point * MotorModel::duty_step;
+        std::array<int, count> sums {};
+        for (int direction : { 1, -1 }) {
+            drive(duty * direction);
+            sleep(300ms);
+            for (int sample = 0; sample < 10; sample++) {
+                sleep(20ms);
+                for (size_t index = 0; index < count; index++) {
+                    sums[index] += speed_of(index);
+                }
+            }
+        }
+        for (size_t index = 0; index < count; index++) {
+            models[index].speeds[point] = static_cast<int16_t>(sums[index] / 20);
+        }
+    }
+
+    // deadband: lowering the duty cycle of the running motor until it stops
+    for (int direction : { 1, -1 }) {
+        std::array<bool, count> stopped {};
+        drive(30 * direction);
+        sleep(300ms);
+        for (int duty = 30; duty >= 0; duty--) {
+            drive(duty * direction);
+            sleep(100ms);
+            for (size_t index = 0; index < count; index++) {
+                if (!stopped[index] && speed_of(index) == 0) {
+                    stopped[index] = true;
+                    models[index].deadband = std::max<int16_t>(models[index].deadband, duty + 1);
+                }
+            }
+        }
+    }
+
+    for (auto motor : motors) {
+        motor->stop();
+    }
+
+    // below the deadband the motor does not turn, above it the table has to be monotonic for the lookup
+    for (auto &model : models) {
+        for (int point = 0; point < MotorModel::points; point++) {
+            if (point * MotorModel::duty_step < model.deadband) {
+                model.speeds[point] = 0;
+            } else if (point > 0) {
+                model.speeds[point] = std::max(model.speeds[point], model.speeds[point - 1]);
+            }
+        }
+        Logger::info("identify_motor_models -", model);
+    }
+    return models;
+}
+
+} // namespace
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace FRT
+{
+
+/// @brief Named parameters in a memory mapped file, so gains can be tuned from another process while the program runs.
+/// Only values set explicitly override the defaults of the program, the defaults are kept up to date beside them for listing,
+/// so a changed profile is not shadowed by the default an earlier build wrote.
+/// Every slot is a seqlock: writers make the sequence odd while changing the value,
+/// readers retry if it changed meanwhile, so reading never blocks and never sees a half written value.
+class ParameterStore
+{
+    public:
+        static constexpr size_t capacity = 64;
+        static constexpr size_t name_length = 24;
+
+        struct Entry
+        {
+            double value;
+            // set explicitly, otherwise the value is the default of the program
+            bool overridden;
+        };
+
+    private:
+        static constexpr uint32_t format = 0x46525402;
+
+        struct Slot
+        {
+            // zero for unused slots, odd while a write is in progress
+            std::atomic<uint32_t> sequence;
+            // the bits of a double, in words that are lock-free on 32 bit targets too
+            std::atomic<uint32_t> low, high;
+            std::atomic<uint32_t> overridden;
+            char name[name_length];
+        };
+
+        struct Layout
+        {
+            std::atomic<uint32_t> format;
+            std::atomic<uint32_t> count;
+            Slot slots[capacity];
+        };
+
+        static_assert(std::atomic<uint32_t>::is_always_lock_free, "ParameterStore - the shared atomics must be lock-free");
+
+        // a writer killed in the middle leaves the sequence odd, retries are bounded so readers fall back instead of spinning
+        static constexpr int max_attempts = 1000;
+
+        Layout *layout = nullptr;
+        std::atomic<uint32_t> stuck = 0;
+
+        /// @returns Nothing if a write seems to be stuck, e.g. the writing process was killed in the middle.
+        static std::optional<Entry> read (const Slot &slot)
+        {
+            for (int attempt = 0; attempt < max_attempts; attempt++) {
+                const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                const uint64_t bits = (uint64_t)slot.high.load(std::memory_order_relaxed) << 32 | slot.low.load(std::memory_order_relaxed);
+                const bool overridden = slot.overridden.load(std::memory_order_relaxed) != 0;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                    return Entry { std::bit_cast<double>(bits), overridden };
+                }
+            }
+            return std::nullopt;
+        }
+
+        static void store_value (Slot &slot, const double value)
+        {
+            const uint64_t bits = std::bit_cast<uint64_t>(value);
+            slot.low.store((uint32_t)bits, std::memory_order_relaxed);
+            slot.high.store((uint32_t)(bits >> 32), std::memory_order_relaxed);
+        }
+
+        /// @brief Changes a slot in the write section of its seqlock, so writers of both processes are serialized.
+        /// @returns False if another write seems to be stuck.
+        template <typename Change>
+        static bool write (Slot &slot, Change &&change)
+        {
+            // taking the slot from an even sequence, waiting out other writers
+            uint32_t sequence = slot.sequence.load(std::memory_order_relaxed) & ~1u;
+            int attempt = 0;
+            while (!slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+                if (++attempt == max_attempts) {
+                    return false;
+                }
+                std::this_thread::yield();
+                sequence &= ~1u;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+
+            change();
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+            return true;
+        }
+
+        /// @brief Logs the first stuck slot and every 100th, controls read parameters at the start of every motion.
+        void report_stuck (const std::string_view name, const std::string_view operation)
+        {
+            const uint32_t count = stuck.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (count == 1 || count % 100 == 0) {
+                Logger::warning("ParameterStore::" + std::string(operation), "- write in progress for ever on", name, "using the default, occurrences:", count);
+            }
+        }
+
+        static std::string_view name_of (const Slot &slot)
+        {
+            return std::string_view(slot.name, strnlen(slot.name, name_length));
+        }
+
+        Slot *find (const std::string_view name) const
+        {
+            const uint32_t count = std::min<uint32_t>(layout->count.load(std::memory_order_acquire), capacity);
+            for (uint32_t index = 0; index < count; index++) {
+                auto &slot = layout->slots[index];
+                if (slot.sequence.load(std::memory_order_acquire) != 0 && name_of(slot) == name) {
+                    return &slot;
+                }
+            }
+            return nullptr;
+        }
+
+        Slot *add (const std::string_view name, const double value, const bool overridden)
+        {
+            if (name.size() >= name_length) {
+                Logger::error("ParameterStore::add - name too long:", name);
+                return nullptr;
+            }
+
+            const uint32_t index = layout->count.fetch_add(1, std::memory_order_acq_rel);
+            if (index >= capacity) {
+                layout->count.store(capacity, std::memory_order_release);
+                Logger::error("ParameterStore::add - store is full, cannot add", name);
+                return nullptr;
+            }
+
+            // the slot is invisible until its sequence is published
+            auto &slot = layout->slots[index];
+            std::memcpy(slot.name, name.data(), name.size());
+            store_value(slot, value);
+            slot.overridden.store(overridden, std::memory_order_relaxed);
+            slot.sequence.store(2, std::memory_order_release);
+            return &slot;
+        }
+
+    public:
+        /// @param path The file is created if it does not exist. If it cannot be mapped, every parameter keeps its default.
+        ParameterStore (const std::string &path)
+        {
+            const int descriptor = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (descriptor < 0) {
+                Logger::warning("ParameterStore - cannot open", path, "using defaults");
+                return;
+            }
+
+            struct stat status;
+            const bool sized = fstat(descriptor, &status) == 0 && status.st_size == (off_t)sizeof(Layout);
+            // a file of another size is from another format, it is cleared
+            if (!sized && (ftruncate(descriptor, 0) != 0 || ftruncate(descriptor, sizeof(Layout)) != 0)) {
+                Logger::warning("ParameterStore - cannot resize", path, "using defaults");
+                close(descriptor);
+                return;
+            }
+
+            void *memory = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            close(descriptor);
+            if (memory == MAP_FAILED) {
+                Logger::warning("ParameterStore - cannot map", path, "using defaults");
+                return;
+            }
+
+            layout = static_cast<Layout *>(memory);
+            uint32_t expected = 0;
+            if (!layout->format.compare_exchange_strong(expected, format) && expected != format) {
+                Logger::warning("ParameterStore - unknown format in", path, "using defaults");
+                munmap(layout, sizeof(Layout));
+                layout = nullptr;
+            }
+        }
+
+        ParameterStore (const ParameterStore &) = delete;
+
+        ~ParameterStore ()
+        {
+            if (layout) {
+                munmap(layout, sizeof(Layout));
+            }
+        }
+
+        bool is_open () const
+        {
+            return layout != nullptr;
+        }
+
+        /// @brief The value set for a parameter, otherwise the default, which is listed beside the set ones.
+        double get (const std::string_view name, const double fallback)
+        {
+            if (!layout) {
+                return fallback;
+            }
+            const auto slot = find(name);
+            if (!slot) {
+                add(name, fallback, false);
+                return fallback;
+            }
+
+            const auto entry = read(*slot);
+            if (!entry) {
+                report_stuck(name, "get");
+                return fallback;
+            }
+            if (entry->overridden) {
+                return entry->value;
+            }
+            // the default of another build, e.g. before a profile change, only updated for listing
+            if (entry->value != fallback) {
+                write(*slot, [slot, fallback] {
+                    if (!slot->overridden.load(std::memory_order_relaxed)) {
+                        store_value(*slot, fallback);
+                    }
+                });
+            }
+            return fallback;
+        }
+
+        /// @brief Overrides the default of a parameter, adding it if it does not exist yet.
+        /// @returns False if the store is not open or full, or the slot is stuck.
+        bool set (const std::string_view name, const double value)
+        {
+            if (!layout) {
+                return false;
+            }
+            if (const auto slot = find(name)) {
+                const bool written = write(*slot, [slot, value] {
+                    store_value(*slot, value);
+                    slot->overridden.store(1, std::memory_order_relaxed);
+                });
+                if (!written) {
+                    report_stuck(name, "set");
+                }
+                return written;
+            }
+            return add(name, value, true) != nullptr;
+        }
+
+        /// @brief Returns a parameter to the default of the program, from its next ParameterStore::get.
+        /// @returns False if the store is not open, the parameter does not exist or the slot is stuck.
+        bool reset (const std::string_view name)
+        {
+            if (!layout) {
+                return false;
+            }
+            const auto slot = find(name);
+            if (!slot) {
+                return false;
+            }
+            const bool written = write(*slot, [slot] {
+                slot->overridden.store(0, std::memory_order_relaxed);
+            });
+            if (!written) {
+                report_stuck(name, "reset");
+            }
+            return written;
+        }
+
+        /// @brief Calls function(name, entry) for every parameter, skipping stuck ones.
+        template <typename Function>
+        void for_each (Function &&function) const
+        {
+            if (!layout) {
+                return;
+            }
+            const uint32_t count = std::min<uint32_t>(layout->count.load(std::memory_order_acquire), capacity);
+            for (uint32_t index = 0; index < count; index++) {
+                const auto &slot = layout->slots[index];
+                if (slot.sequence.load(std::memory_order_acquire) == 0) {
+                    continue;
+                }
+                if (const auto entry = read(slot)) {
+                    function(name_of(slot), *entry);
+                }
+            }
+        }
+};
+
+} // namespace
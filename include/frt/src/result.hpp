@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+namespace FRT
+{
+
+enum class IOError : uint8_t
+{
+    none,
+    // the file could not be opened, e.g. the device is unplugged
+    open,
+    read,
+    write,
+};
+
+/// @brief Value or the error that prevented it, in the manner of std::expected, which is only in C++23.
+template <typename T>
+class Result
+{
+    private:
+        T stored {};
+        IOError failure = IOError::none;
+
+    public:
+        Result (const T &value)
+        : stored(value)
+        {}
+
+        Result (T &&value)
+        : stored(std::move(value))
+        {}
+
+        Result (const IOError error)
+        : failure(error)
+        {}
+
+        bool has_value () const
+        {
+            return failure == IOError::none;
+        }
+
+        explicit operator bool () const
+        {
+            return has_value();
+        }
+
+        /// @brief The value, default constructed on errors.
+        const T &value () const
+        {
+            return stored;
+        }
+
+        const T &operator* () const
+        {
+            return stored;
+        }
+
+        const T *operator-> () const
+        {
+            return &stored;
+        }
+
+        T value_or (const T &fallback) const
+        {
+            return has_value() ? stored : fallback;
+        }
+
+        IOError error () const
+        {
+            return failure;
+        }
+};
+
+template <>
+class Result<void>
+{
+    private:
+        IOError failure = IOError::none;
+
+    public:
+        Result () = default;
+
+        Result (const IOError error)
+        : failure(error)
+        {}
+
+        bool has_value () const
+        {
+            return failure == IOError::none;
+        }
+
+        explicit operator bool () const
+        {
+            return has_value();
+        }
+
+        IOError error () const
+        {
+            return failure;
+        }
+};
+
+} // namespace
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "function.hpp"
+#include "logger.hpp"
+#include "utility.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace FRT
+{
+
+struct TaskStatistics
+{
+    uint32_t runs = 0;
+    // runs of periodic tasks that finished after the next release
+    uint32_t overruns = 0;
+    // releases dropped because the task fell more than a period behind
+    uint32_t skipped = 0;
+    std::chrono::nanoseconds total_runtime = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds max_runtime = std::chrono::nanoseconds::zero();
+    // the largest delay between the release time and the actual start
+    std::chrono::nanoseconds max_latency = std::chrono::nanoseconds::zero();
+};
+
+/// @brief Cooperative scheduler with a fixed-capacity task table.
+/// Tasks are run on the thread calling Scheduler::run, one at a time, the highest priority due task first.
+/// Tasks can be added and cancelled from any thread without locking or allocating.
+/// @tparam capacity Maximal number of tasks.
+/// @tparam function_capacity Maximal size of a task's callable in bytes.
+template <size_t capacity = 16, size_t function_capacity = 4 * sizeof(void *)>
+class Scheduler
+{
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct TaskHandle
+        {
+            uint32_t index = capacity;
+            uint32_t generation = 0;
+
+            bool valid () const
+            {
+                return index < capacity;
+            }
+        };
+
+    private:
+        // slot words hold the state in the lowest two bits and a generation counter in the rest,
+        // so stale handles cannot cancel a task that reuses the same slot
+        enum states : uint32_t
+        {
+            free = 0,
+            reserved = 1,
+            active = 2,
+            cancelled = 3,
+        };
+
+        static constexpr uint32_t state_mask = 3;
+        static constexpr uint32_t generation_shift = 2;
+
+        struct Task
+        {
+            std::atomic<uint32_t> word = 0;
+            const char *name = "";
+            InplaceFunction<bool(), function_capacity> function;
+            clock::duration period = clock::duration::zero();
+            int priority = 0;
+            clock::time_point release;
+            TaskStatistics statistics;
+        };
+
+        std::array<Task, capacity> tasks;
+        std::atomic<bool> running = false;
+        const clock::duration max_sleep;
+
+        void free_task (Task &task)
+        {
+            task.function.reset();
+            const uint32_t generation = (task.word.load(std::memory_order_relaxed) >> generation_shift) + 1;
+            task.word.store(generation << generation_shift, std::memory_order_release);
+        }
+
+        void run_task (Task &task)
+        {
+            const auto start = clock::now();
+            const bool keep = task.function();
+            const auto end = clock::now();
+
+            auto &statistics = task.statistics;
+            statistics.runs++;
+            statistics.total_runtime += end - start;
+            statistics.max_runtime = std::max<std::chrono::nanoseconds>(statistics.max_runtime, end - start);
+            statistics.max_latency = std::max<std::chrono::nanoseconds>(statistics.max_latency, start - task.release);
+
+            if (!keep || task.period == clock::duration::zero()) {
+                free_task(task);
+                return;
+            }
+
+            task.release += task.period;
+            if (end > task.release) {
+                statistics.overruns++;
+            }
+            // releasing on an absolute timeline, but not trying to catch up on whole periods
+            if (end - task.release >= task.period) {
+                const auto missed = (end - task.release) / task.period;
+                statistics.skipped += missed;
+                task.release += missed * task.period;
+            }
+        }
+
+    public:
+        /// @param max_sleep Upper bound of idle sleeps, tasks added from other threads are noticed within this time.
+        Scheduler (const clock::duration max_sleep = std::chrono::milliseconds(1))
+        : max_sleep(max_sleep)
+        {}
+
+        Scheduler (const Scheduler &) = delete;
+
+        /// @brief Registers a task. Safe to call from any thread, including from running tasks.
+        /// @param name Used for logging, must outlive the task.
+        /// @param callable Returns void, or bool where false cancels the task.
+        /// @param period Zero for one-shot tasks, otherwise releases follow each other with this period.
+        /// @param priority Higher priority tasks are run first when several are due.
+        /// @param delay Time from now to the first release.
+        /// @returns An invalid handle if the task table is full.
+        template <typename Callable>
+        TaskHandle add_task (const char *name, Callable &&callable, const clock::duration period = clock::duration::zero(), const int priority = 0, const clock::duration delay = clock::duration::zero())
+        {
+            for (uint32_t index = 0; index < capacity; index++) {
+                auto &task = tasks[index];
+                uint32_t word = task.word.load(std::memory_order_relaxed);
+                if ((word & state_mask) != free) {
+                    continue;
+                }
+                if (!task.word.compare_exchange_strong(word, word | reserved, std::memory_order_acquire)) {
+                    continue;
+                }
+
+                if constexpr (std::is_void_v<std::invoke_result_t<std::decay_t<Callable> &>>) {
+                    task.function = [callable = std::forward<Callable>(callable)] () mutable {
+                        callable();
+                        return true;
+                    };
+                } else {
+                    task.function = std::forward<Callable>(callable);
+                }
+
+                task.name = name;
+                task.period = period;
+                task.priority = priority;
+                task.release = clock::now() + delay;
+                task.statistics = {};
+
+                task.word.store(word | active, std::memory_order_release);
+                return TaskHandle { index, word >> generation_shift };
+            }
+
+            Logger::error("Scheduler::add_task - task table is full, cannot add", name);
+            return TaskHandle {};
+        }
+
+        /// @brief Cancels a task. Safe to call from any thread. A running task finishes its current run.
+        /// @returns False if the task has already finished or been cancelled.
+        bool cancel (const TaskHandle handle)
+        {
+            if (!handle.valid()) {
+                return false;
+            }
+            uint32_t expected = (handle.generation << generation_shift) | active;
+            const uint32_t desired = (handle.generation << generation_shift) | cancelled;
+            return tasks[handle.index].word.compare_exchange_strong(expected, desired, std::memory_order_acq_rel);
+        }
+
+        /// @brief Runs the most urgent due task, if there is one.
+        /// @returns The time until which there is nothing to do.
+        clock::time_point step ()
+        {
+            const auto now = clock::now();
+            Task *selected = nullptr;
+            auto next_release = clock::time_point::max();
+
+            for (auto &task : tasks) {
+                const auto state = task.word.load(std::memory_order_acquire) & state_mask;
+                if (state == cancelled) {
+                    free_task(task);
+                    continue;
+                }
+                if (state != active) {
+                    continue;
+                }
+                if (task.release > now) {
+                    next_release = std::min(next_release, task.release);
+                    continue;
+                }
+                if (!selected || task.priority > selected->priority || (task.priority == selected->priority && task.release < selected->release)) {
+                    selected = &task;
+                }
+            }
+
+            if (!selected) {
+                return next_release;
+            }
+
+            run_task(*selected);
+            return now;
+        }
+
+        /// @brief Runs tasks on the calling thread until Scheduler::stop is called.
+        void run ()
+        {
+            running = true;
+            while (running.load(std::memory_order_relaxed)) {
+                const auto next = step();
+                const auto now = clock::now();
+                if (next > now) {
+                    std::this_thread::sleep_until(std::min(next, now + max_sleep));
+                }
+            }
+        }
+
+        void stop ()
+        {
+            running = false;
+        }
+
+        /// @brief Statistics of a task. Consistent only on the scheduler thread or while the scheduler is not running.
+        const TaskStatistics &get_statistics (const TaskHandle handle) const
+        {
+            return tasks.at(handle.index).statistics;
+        }
+
+        void log_statistics () const
+        {
+            using namespace std::chrono;
+
+            for (const auto &task : tasks) {
+                if ((task.word.load(std::memory_order_acquire) & state_mask) != active) {
+                    continue;
+                }
+                const auto &statistics = task.statistics;
+                const auto average = statistics.runs ? statistics.total_runtime / statistics.runs : nanoseconds::zero();
+                Logger::info("Scheduler -", task.name,
+                    "runs:", statistics.runs,
+                    "avg us:", duration_cast<microseconds>(average).count(),
+                    "max us:", duration_cast<microseconds>(statistics.max_runtime).count(),
+                    "max latency us:", duration_cast<microseconds>(statistics.max_latency).count(),
+                    "overruns:", statistics.overruns,
+                    "skipped:", statistics.skipped);
+            }
+        }
+};
+
+} // namespace
@@ -1,6 +1,15 @@
 #pragma once
 
 #include "device.hpp"
+#include "freshness.hpp"
+#include "function.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
 
 namespace FRT
 {
@@ -10,6 +19,7 @@ class SensorInterface : public Device
     public:
         using Device::Device;
 
+        // shared, the gyro is set up by the main thread and read by the gyro processor
         FRT::File address = attribute("address");
         FRT::File bin_data = attribute("bin_data");
         FRT::File bin_data_format = attribute("bin_data_format");
@@ -49,10 +59,85 @@ struct ColorBase
     }
 };
 
+struct ModeStatistics
+{
+    uint32_t switches = 0;
+    // switches sooner than Sensor::rapid_switch_interval after the previous one, a sign of interleaved reads of different modes
+    uint32_t rapid_switches = 0;
+    // total time reads waited for the first sample of a new mode
+    std::chrono::nanoseconds settle_wait = std::chrono::nanoseconds::zero();
+};
+
 class Sensor
 {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        static constexpr auto rapid_switch_interval = std::chrono::milliseconds(100);
+
     protected:
         std::string mode = "";
+        // bin_data_format and num_values of the current mode, read on first use
+        std::string value_format = "";
+        int value_count = 0;
+
+        // time the sensor needs after a mode switch to deliver a sample of the new mode
+        clock::duration settle_time = std::chrono::milliseconds(20);
+        clock::time_point last_switch = clock::time_point::min();
+        clock::time_point settled = clock::time_point::min();
+        ModeStatistics mode_statistics;
+
+        // values of the last reading, to tag repeats, see Sensor::get_reading
+        FreshnessTracker<std::array<int, 8>> freshness;
+
+        /// @brief Waits until a sample of the current mode is available, only blocks right after a mode switch.
+        void wait_for_settle ()
+        {
+            if (settled == clock::time_point::min()) {
+                return;
+            }
+            const auto now = clock::now();
+            if (now < settled) {
+                std::this_thread::sleep_until(settled);
+                mode_statistics.settle_wait += settled - now;
+            }
+            settled = clock::time_point::min();
+        }
+
+        /// @brief Reads a value of the current mode, after it settled.
+        int read_value (const size_t index)
+        {
+            wait_for_settle();
+            return attributes.value[index].read<int>();
+        }
+
+        template <typename T>
+        static T load_value (const uint8_t *data, const size_t index)
+        {
+            T value;
+            std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+            return value;
+        }
+
+        static int decode_value (const uint8_t *data, const std::string_view format, const size_t index)
+        {
+            if (format == "u8") return load_value<uint8_t>(data, index);
+            if (format == "s8") return load_value<int8_t>(data, index);
+            if (format == "u16") return load_value<uint16_t>(data, index);
+            if (format == "s16") return load_value<int16_t>(data, index);
+            if (format == "s16_be") return (int16_t)__builtin_bswap16(load_value<uint16_t>(data, index));
+            if (format == "s32") return load_value<int32_t>(data, index);
+            if (format == "s32_be") return (int32_t)__builtin_bswap32(load_value<uint32_t>(data, index));
+            if (format == "float") return (int)load_value<float>(data, index);
+            return 0;
+        }
+
+        static size_t value_size (const std::string_view format)
+        {
+            if (format == "u8" || format == "s8") return 1;
+            if (format == "u16" || format == "s16" || format == "s16_be") return 2;
+            return 4;
+        }
 
     public:
         SensorInterface attributes;
@@ -80,12 +165,99 @@ class Sensor
             attributes.command.write(command);
         }
 
+        /// @brief Switches the mode if it differs. Reads wait for the sensor to settle afterwards, and switches are counted.
         void set_mode (const std::string_view value)
         {
-            if (value != mode) {
-                attributes.mode.write(value);
-                mode = value;
+            if (value == mode) {
+                return;
+            }
+
+            attributes.mode.write(value);
+            mode = value;
+            value_format.clear();
+            freshness.reset();
+
+            const auto now = clock::now();
+            mode_statistics.switches++;
+            if (now - last_switch < rapid_switch_interval) {
+                mode_statistics.rapid_switches++;
+                if (mode_statistics.rapid_switches == 1 || mode_statistics.rapid_switches % 100 == 0) {
+                    Logger::warning("Sensor::set_mode - mode thrash on", port, "switching to", value, "rapid switches:", mode_statistics.rapid_switches);
+                }
             }
+            last_switch = now;
+            settled = now + settle_time;
+        }
+
+        void set_settle_time (const clock::duration duration)
+        {
+            settle_time = duration;
+        }
+
+        const ModeStatistics &get_mode_statistics () const
+        {
+            return mode_statistics;
+        }
+
+        void log_mode_statistics () const
+        {
+            using namespace std::chrono;
+            Logger::info("Sensor -", port, "mode switches:", mode_statistics.switches,
+                "rapid:", mode_statistics.rapid_switches,
+                "settle wait ms:", duration_cast<milliseconds>(mode_statistics.settle_wait).count());
+        }
+
+        /// @brief Reads every value of a mode at once, the way to group reads instead of a getter per value.
+        template <size_t count>
+        std::array<int, count> read_mode (const std::string_view value)
+        {
+            set_mode(value);
+            return get_values<count>();
+        }
+
+        /// @brief Reads the first count values of the current mode at once, from bin_data instead of a file per value.
+        /// Values beyond the number of values of the mode are zero.
+        template <size_t count>
+        std::array<int, count> get_values ()
+        {
+            if (value_format.empty()) {
+                value_format = attributes.bin_data_format.read<std::string>();
+                value_count = attributes.num_values.read<int>();
+            }
+            wait_for_settle();
+
+            std::array<uint8_t, 32> data;
+            const size_t size = value_size(value_format);
+            const size_t available = std::min<size_t>(count, value_count);
+            std::array<int, count> values {};
+            if (available * size > data.size()) {
+                Logger::error("Sensor::get_values - cannot read", available, "values of format", value_format);
+                return values;
+            }
+            // failed and short reads are counted and reported by the file, the values stay zero
+            if (attributes.bin_data.read_bytes(data.data(), available * size) < (ssize_t)(available * size)) {
+                return values;
+            }
+
+            for (size_t index = 0; index < available; index++) {
+                values[index] = decode_value(data.data(), value_format, index);
+            }
+            return values;
+        }
+
+        /// @brief Reads the first count values of the current mode, tagged whether they are a new sample or a repeat of the previous reading.
+        /// Loops running faster than the sensor updates can skip repeats, e.g. derivative terms.
+        template <size_t count>
+        Reading<std::array<int, count>> get_reading ()
+        {
+            static_assert(count <= 8, "Sensor::get_reading - at most 8 values");
+
+            const auto values = get_values<count>();
+            std::array<int, 8> padded {};
+            std::copy(values.begin(), values.end(), padded.begin());
+
+            const auto tagged = freshness.update(padded);
+            return Reading<std::array<int, count>> { values, tagged.fresh, tagged.time };
         }
 
         std::string get_mode () 
@@ -106,15 +278,105 @@ class Sensor
             return attributes.num_values.read<int>();
         }
 
-        void set_poll_ms (const int ms)
+        /// @brief Only NXT analog and I2C sensors are polled by the driver, EV3 sensors send their samples themselves.
+        bool supports_poll_ms () const
         {
+            return !driver_name.starts_with("lego-ev3-");
+        }
+
+        /// @brief Sets how often the driver polls the sensor, and with it the period after which an unchanged value is a new sample.
+        /// Sensors sending their samples themselves keep their rate, the period then only tags repeats.
+        /// @returns False if the sensor has no poll rate, which is not an error.
+        bool set_poll_ms (const int ms)
+        {
+            freshness.set_period(std::chrono::milliseconds(ms));
+            if (!supports_poll_ms()) {
+                Logger::info("Sensor::set_poll_ms -", driver_name, "on", port, "has no poll rate, expecting samples every", ms, "ms");
+                return false;
+            }
+
             attributes.poll_ms.write(ms);
+            return true;
         }
 
         int get_poll_ms ()
         {
             return attributes.poll_ms.read<int>();
         }
+
+        /// @brief Reads a block of registers straight from an I2C sensor with a single read of the direct attribute,
+        /// regardless of the polling of the driver.
+        /// @returns False if not every byte could be read.
+        bool read_direct (const uint8_t address, void *buffer, const size_t size)
+        {
+            // failed and short reads are counted and reported by the file
+            return attributes.direct.read_bytes(buffer, size, address) == (ssize_t)size;
+        }
+};
+
+/// @brief Collects reads of several modes and performs them with the fewest mode switches:
+/// the current mode first, then every other mode once, in the order of their first request.
+/// @tparam capacity Maximal number of requests between two runs.
+template <size_t capacity = 8>
+class SensorBatch
+{
+    public:
+        using Values = std::array<int, 8>;
+
+    private:
+        struct Request
+        {
+            std::string_view mode;
+            InplaceFunction<void(const Values &)> callback;
+        };
+
+        Sensor &sensor;
+        std::array<Request, capacity> requests;
+        size_t count = 0;
+
+        void run_mode (const std::string_view mode, bool *done)
+        {
+            const auto values = sensor.read_mode<8>(mode);
+            for (size_t index = 0; index < count; index++) {
+                if (!done[index] && requests[index].mode == mode) {
+                    requests[index].callback(values);
+                    done[index] = true;
+                }
+            }
+        }
+
+    public:
+        SensorBatch (Sensor &sensor)
+        : sensor(sensor)
+        {}
+
+        /// @param callback Called with the values of the mode when the batch runs.
+        template <typename Callback>
+        void add (const std::string_view mode, Callback &&callback)
+        {
+            if (count == capacity) {
+                Logger::error("SensorBatch::add - batch is full, dropping a read of", mode);
+                return;
+            }
+            requests[count++] = Request { mode, std::forward<Callback>(callback) };
+        }
+
+        void run ()
+        {
+            bool done[capacity] = {};
+            const auto current = sensor.get_mode();
+            run_mode(current, done);
+            for (size_t index = 0; index < count; index++) {
+                if (!done[index]) {
+                    run_mode(requests[index].mode, done);
+                }
+            }
+
+            for (size_t index = 0; index < count; index++) {
+                requests[index].callback.reset();
+            }
+            count = 0;
+        }
 };
 
 class ColorSensor : public Sensor
@@ -155,40 +417,52 @@ class ColorSensor : public Sensor
             }
         };
 
+        struct RGB
+        {
+            int red, green, blue;
+        };
+
+        /// @brief All channels with a single read, instead of get_red, get_green and get_blue.
+        RGB get_rgb ()
+        {
+            const auto values = read_mode<3>(modes::raw_rgb);
+            return RGB { values[0], values[1], values[2] };
+        }
+
         int get_red ()
         {
             set_mode(modes::raw_rgb);
-            return attributes.value[0].read<int>();
+            return read_value(0);
         }
 
         int get_green ()
         {
             set_mode(modes::raw_rgb);
-            return attributes.value[1].read<int>();
+            return read_value(1);
         }
 
         int get_blue ()
         {
             set_mode(modes::raw_rgb);
-            return attributes.value[2].read<int>();
+            return read_value(2);
         }
 
         int get_reflected_light_intensity ()
         {
             set_mode(modes::reflected_light_intensity);
-            return attributes.value[0].read<int>();
+            return read_value(0);
         }
 
         int get_ambient_light_intensity ()
         {
             set_mode(modes::ambient_light_intensity);
-            return attributes.value[0].read<int>();
+            return read_value(0);
         }
 
         Color get_color ()
         {
             set_mode(modes::color);
-            const int value = attributes.value[0].read<int>();
+            const int value = read_value(0);
             return Color(value);
         }
 };
@@ -258,34 +532,83 @@ class HTColorSensorV2 : public Sensor
             }
         };
 
+        struct RGBW
+        {
+            int red, green, blue, white;
+        };
+
+        // registers of the active modes, one byte each
+        struct registers
+        {
+            static constexpr uint8_t color = 0x42;
+            static constexpr uint8_t red = 0x43;
+            static constexpr uint8_t green = 0x44;
+            static constexpr uint8_t blue = 0x45;
+            static constexpr uint8_t white = 0x46;
+        };
+
+        struct ColorAndRGBW
+        {
+            Color color = 0;
+            RGBW rgbw {};
+        };
+
+        /// @brief Stops the polling of the driver, so HTColorSensorV2::read_direct is the only traffic on the bus.
+        /// Sets an active mode, the registers are only updated in those.
+        void enable_direct_access ()
+        {
+            set_mode(modes::rgbw);
+            set_poll_ms(0);
+        }
+
+        using Sensor::read_direct;
+
+        /// @brief Color number and channels sampled right now, with a single read of the registers instead of the last poll of the driver.
+        /// @returns An error if not every register could be read, the zeros of a failed read are not a color.
+        Result<ColorAndRGBW> read_direct ()
+        {
+            std::array<uint8_t, 5> data {};
+            if (!Sensor::read_direct(registers::color, data.data(), data.size())) {
+                return IOError::read;
+            }
+            return ColorAndRGBW { Color(data[0]), RGBW { data[1], data[2], data[3], data[4] } };
+        }
+
+        /// @brief All channels with a single read, instead of a getter per channel.
+        RGBW get_rgbw ()
+        {
+            const auto values = read_mode<4>(modes::rgbw);
+            return RGBW { values[0], values[1], values[2], values[3] };
+        }
+
         int get_red ()
         {
             set_mode(modes::rgbw);
-            return attributes.value[0].read<int>();
+            return read_value(0);
         }
 
         int get_green ()
         {
             set_mode(modes::rgbw);
-            return attributes.value[1].read<int>();
+            return read_value(1);
         }
 
         int get_blue ()
         {
             set_mode(modes::rgbw);
-            return attributes.value[2].read<int>();
+            return read_value(2);
         }
 
         int get_white ()
         {
             set_mode(modes::rgbw);
-            return attributes.value[3].read<int>();
+            return read_value(3);
         }
 
         Color get_color ()
         {
             set_mode(modes::color);
-            const int value = attributes.value[0].read<int>();
+            const int value = read_value(0);
             return Color(value);
         }
 };
@@ -334,7 +657,7 @@ class GyroSensor : public Sensor
         void reset ()
         {
             set_mode(modes::angle_and_rate);
-            base = attributes.value[0].read<int>();
+            base = read_value(0);
         }
 
         struct AngleAndRate
@@ -346,36 +669,51 @@ class GyroSensor : public Sensor
         AngleAndRate get_angle_and_rate ()
         {
             set_mode(modes::angle_and_rate);
-            const int angle = attributes.value[0].read<int>();
-            const int rate = attributes.value[1].read<int>();
+            const int angle = read_value(0);
+            const int rate = read_value(1);
             return AngleAndRate { deg(angle) - base, deg(rate) };
         }
 
         deg get_angle ()
         {
             set_mode(modes::angle_and_rate);
-            const int angle = attributes.value[0].read<int>();
+            const int angle = read_value(0);
             return deg(angle) - base;
         }
 
         deg get_rate ()
         {
             set_mode(modes::angle_and_rate);
-            const int rate = attributes.value[1].read<int>();
-            return deg(rate) - base;
+            const int rate = read_value(1);
+            return deg(rate);
+        }
+
+        /// @brief Unscaled rate of the fast mode, see FRT::GyroProcessor.
+        int get_raw_rate ()
+        {
+            set_mode(modes::rate_raw);
+            return read_value(0);
+        }
+
+        /// @brief GyroSensor::get_raw_rate tagged whether it is a new sample.
+        Reading<int> get_raw_rate_reading ()
+        {
+            set_mode(modes::rate_raw);
+            const auto reading = get_reading<1>();
+            return Reading<int> { reading.value[0], reading.fresh, reading.time };
         }
 
         deg get_tilt_rate ()
         {
             set_mode(modes::tilt_rate);
-            const int value = attributes.value[0].read<int>();
+            const int value = read_value(0);
             return deg(value);
         }
 
         deg get_tilt_angle ()
         {
             set_mode(modes::tilt_angle);
-            const int value = attributes.value[0].read<int>();
+            const int value = read_value(0);
             return deg(value);
         }
 };
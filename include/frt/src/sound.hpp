@@ -1,7 +1,16 @@
 #pragma once
 
-#include <cstdlib>
-#include <string>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <unistd.h>
 
 namespace FRT
 {
@@ -9,23 +18,149 @@ namespace FRT
 namespace Sound
 {
 
-template <bool async = false>
-inline void beep (const std::string args = "")
-{   
-    std::string command = "beep " + args;
-    if constexpr (async) {
-        command += " &";
+struct Tone
+{
+    // in Hz, zero is a rest
+    int frequency;
+    int duration_ms;
+    // silence after the tone
+    int pause_ms = 0;
+};
+
+/// @brief Plays tones on the EV3 speaker from a background thread, through the tone events of its input device.
+/// Callers only queue tones, without forking a process per beep. Without the device, tones pass silently in their time.
+class Player
+{
+    public:
+        static constexpr const char *device = "/dev/input/by-path/platform-sound-event";
+        static constexpr size_t capacity = 16;
+
+    private:
+        std::mutex mutex;
+        std::condition_variable queued;
+        std::condition_variable finished;
+        std::array<Tone, capacity> tones {};
+        size_t head = 0, count = 0;
+        // tickets of the tones, to wait for a given one
+        uint32_t last_ticket = 0, played = 0;
+        const int descriptor;
+
+        void send (const int frequency)
+        {
+            if (descriptor < 0) {
+                return;
+            }
+            input_event event {};
+            event.type = EV_SND;
+            event.code = SND_TONE;
+            event.value = frequency;
+            [[maybe_unused]] const auto written = ::write(descriptor, &event, sizeof(event));
+        }
+
+        void play (const Tone &tone)
+        {
+            if (tone.frequency > 0) {
+                send(tone.frequency);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(tone.duration_ms));
+            if (tone.frequency > 0) {
+                send(0);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(tone.pause_ms));
+        }
+
+        void loop ()
+        {
+            while (true) {
+                Tone tone;
+                {
+                    std::unique_lock lock(mutex);
+                    queued.wait(lock, [this] { return count > 0; });
+                    tone = tones[head];
+                    head = (head + 1) % capacity;
+                    count--;
+                }
+
+                play(tone);
+
+                {
+                    const std::scoped_lock lock(mutex);
+                    played++;
+                }
+                finished.notify_all();
+            }
+        }
+
+        Player ()
+        : descriptor(open(device, O_WRONLY | O_CLOEXEC))
+        {
+            std::thread(&Player::loop, this).detach();
+        }
+
+    public:
+        Player (const Player &) = delete;
+
+        /// @brief Created by the first tone and never destroyed, so errors logged while the program exits can still queue one.
+        static Player &instance ()
+        {
+            static Player &player = *new Player();
+            return player;
+        }
+
+        /// @returns Ticket of the tone for Player::wait, zero if the queue is full and the tone was dropped.
+        uint32_t enqueue (const Tone &tone)
+        {
+            uint32_t ticket;
+            {
+                const std::scoped_lock lock(mutex);
+                if (count == capacity) {
+                    return 0;
+                }
+                tones[(head + count) % capacity] = tone;
+                count++;
+                ticket = ++last_ticket;
+            }
+            queued.notify_one();
+            return ticket;
+        }
+
+        /// @brief Waits until the tone of the ticket is played.
+        void wait (const uint32_t ticket)
+        {
+            std::unique_lock lock(mutex);
+            finished.wait(lock, [this, ticket] { return played >= ticket; });
+        }
+
+        bool has_device () const
+        {
+            return descriptor >= 0;
+        }
+};
+
+/// @brief Plays a melody, e.g. a mission cue.
+/// @tparam async Whether to return right away instead of waiting for the end of the melody.
+template <bool async = true>
+inline void play (const std::initializer_list<Tone> melody)
+{
+    // the last tone that was not dropped, to wait for the end of the melody even if its last tones did not fit
+    uint32_t ticket = 0;
+    for (const Tone &tone : melody) {
+        if (const uint32_t queued = Player::instance().enqueue(tone)) {
+            ticket = queued;
+        }
     }
-    const int error = std::system(command.c_str());
-    if (error < 0) {
-        // todo: handle error
+    if constexpr (!async) {
+        if (ticket) {
+            Player::instance().wait(ticket);
+        }
     }
 }
 
+/// @tparam async Whether to return right away instead of waiting for the end of the beep.
 template <bool async = false>
-inline void beep (const int frequency, const int duration)
+inline void beep (const int frequency = 440, const int duration = 200)
 {
-    beep<async>("-f " + std::to_string(frequency) + " -l " + std::to_string(duration));
+    play<async>({ Tone { frequency, duration } });
 }
 
 } // namespace Sound
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <deque>
+#include <numbers>
+#include <optional>
+#include <vector>
+
+namespace FRT
+{
+
+struct Sample
+{
+    // seconds
+    double time;
+    double value;
+};
+
+/// @brief Something the tuning routines can excite and measure, a real mechanism or a simulation.
+/// step applies an input, waits for one control tick and returns the measurement with its timestamp.
+template <typename T>
+concept Plant = requires (T plant, const double input)
+{
+    { plant.step(input) } -> std::same_as<Sample>;
+};
+
+/// @brief First order plus dead time model: after dead_time, the output approaches gain * input with time_constant.
+struct FirstOrderModel
+{
+    double gain;
+    double time_constant;
+    double dead_time;
+};
+
+/// @brief Ultimate gain and period of the loop, as found by relay feedback.
+struct RelayResult
+{
+    double ultimate_gain;
+    double ultimate_period;
+    // average length of a tick during the experiment
+    double period;
+};
+
+/// @brief Continuous PID gains in parallel form, Ki per second and Kd in seconds.
+struct PIDGains
+{
+    double Kp, Ki, Kd;
+};
+
+/// @brief Simulated first order plus dead time plant with a deadband, for trying the tuning routines without a robot.
+/// An integrating plant outputs the integral of the response, like a heading driven by a wheel speed difference.
+class SimulatedPlant
+{
+    private:
+        const FirstOrderModel model;
+        const double deadband;
+        const bool integrating;
+        const double period;
+
+        std::deque<double> inputs;
+        double time = 0;
+        double response = 0;
+        double integral = 0;
+
+    public:
+        SimulatedPlant (const FirstOrderModel &model, const double deadband = 0, const bool integrating = false, const double period = 0.005)
+        : model(model),
+          deadband(deadband),
+          integrating(integrating),
+          period(period)
+        {}
+
+        Sample step (const double input)
+        {
+            // the dead time is a queue of inputs, the current input comes out after delay ticks
+            const size_t delay = std::lround(model.dead_time / period);
+            inputs.push_back(input);
+            double delayed = 0;
+            if (inputs.size() > delay) {
+                delayed = inputs.front();
+                inputs.pop_front();
+            }
+
+            const double effective = std::abs(delayed) <= deadband ? 0 : delayed - std::copysign(deadband, delayed);
+            response += (model.gain * effective - response) * (1 - std::exp(-period / model.time_constant));
+            integral += response * period;
+            time += period;
+
+            return Sample { time, integrating ? integral : response };
+        }
+};
+
+/// @brief Applies a constant input and records the response.
+template <Plant P>
+inline std::vector<Sample> step_response (P &plant, const double input, const double duration)
+{
+    std::vector<Sample> samples;
+    samples.reserve(1024);
+
+    const Sample first = plant.step(input);
+    samples.push_back(first);
+    while (samples.back().time - first.time < duration) {
+        samples.push_back(plant.step(input));
+    }
+    return samples;
+}
+
+/// @returns The average time between samples.
+inline double sample_period (const std::vector<Sample> &samples)
+{
+    if (samples.size() < 2) {
+        return 0;
+    }
+    return (samples.back().time - samples.front().time) / (samples.size() - 1);
+}
+
+/// @brief Fits a first order plus dead time model to a step response starting from rest, with the two point method of Smith.
+/// @returns Nothing if the plant did not respond.
+inline std::optional<FirstOrderModel> identify_first_order (const std::vector<Sample> &samples, const double input)
+{
+    if (samples.size() < 10 || input == 0) {
+        Logger::error("identify_first_order - not enough data");
+        return std::nullopt;
+    }
+
+    // the final value is averaged over the last tenth, where the response should have settled
+    const size_t tail = samples.size() / 10;
+    double final = 0;
+    for (size_t index = samples.size() - tail; index < samples.size(); index++) {
+        final += samples[index].value;
+    }
+    final /= tail;
+
+    if (std::abs(final) < 1e-9) {
+        Logger::error("identify_first_order - the plant did not respond");
+        return std::nullopt;
+    }
+
+    const auto time_of = [&] (const double fraction) {
+        const auto it = std::find_if(samples.begin(), samples.end(), [&] (const Sample &sample) {
+            return sample.value / final >= fraction;
+        });
+        return (it == samples.end() ? samples.back().time : it->time) - samples.front().time;
+    };
+
+    const double t28 = time_of(0.283);
+    const double t63 = time_of(0.632);
+    const double time_constant = std::max(1.5 * (t63 - t28), sample_period(samples));
+
+    return FirstOrderModel {
+        .gain = final / input,
+        .time_constant = time_constant,
+        .dead_time = std::max(t63 - time_constant, 0.0)
+    };
+}
+
+/// @brief Makes the loop oscillate with a relay around the setpoint (Astrom-Hagglund), and measures the oscillation.
+/// @param amplitude The input switches between bias + amplitude and bias - amplitude.
+/// @param hysteresis Band around the setpoint without switching, keeps noise from chattering the relay.
+/// @param cycles Number of periods measured, after two periods of settling.
+/// @param timeout Seconds, the experiment is abandoned after it.
+/// @returns Nothing if the loop did not oscillate in time.
+template <Plant P>
+inline std::optional<RelayResult> relay_feedback (P &plant, const double setpoint, const double amplitude, const double hysteresis, const int cycles, const double timeout, const double bias = 0)
+{
+    const int settling = 2;
+
+    Sample sample = plant.step(bias);
+    const double start = sample.time;
+    double input = bias + amplitude;
+
+    std::vector<double> switch_times;
+    int ticks = 0;
+    double high = -INFINITY, low = INFINITY;
+    double amplitude_sum = 0;
+
+    while (sample.time - start < timeout) {
+        sample = plant.step(input);
+        ticks++;
+        high = std::max(high, sample.value);
+        low = std::min(low, sample.value);
+
+        if (input > bias && sample.value > setpoint + hysteresis) {
+            input = bias - amplitude;
+        } else if (input < bias && sample.value < setpoint - hysteresis) {
+            // a period is complete at every switch upward
+            input = bias + amplitude;
+            switch_times.push_back(sample.time);
+
+            const int measured = (int)switch_times.size() - 1 - settling;
+            if (measured > 0) {
+                amplitude_sum += (high - low) / 2;
+            }
+            high = -INFINITY;
+            low = INFINITY;
+
+            if (measured == cycles) {
+                const double oscillation = amplitude_sum / cycles;
+                return RelayResult {
+                    .ultimate_gain = 4 * amplitude / (std::numbers::pi * oscillation),
+                    .ultimate_period = (switch_times.back() - switch_times[settling]) / cycles,
+                    .period = (sample.time - start) / ticks
+                };
+            }
+        }
+    }
+
+    Logger::error("relay_feedback - no sustained oscillation in", timeout, "seconds");
+    return std::nullopt;
+}
+
+/// @brief Skogestad's SIMC rules for a PI controller.
+/// @param closed_loop_time Desired time constant of the controlled loop, the dead time is a good default.
+inline PIDGains simc (const FirstOrderModel &model, const double closed_loop_time)
+{
+    const double Kp = model.time_constant / (model.gain * (closed_loop_time + model.dead_time));
+    const double Ti = std::min(model.time_constant, 4 * (closed_loop_time + model.dead_time));
+    return PIDGains { Kp, Kp / Ti, 0 };
+}
+
+/// @brief Tyreus-Luyben rules, less aggressive than Ziegler-Nichols, with little overshoot.
+inline PIDGains tyreus_luyben (const RelayResult &result)
+{
+    const double Kp = result.ultimate_gain / 2.2;
+    const double Ti = 2.2 * result.ultimate_period;
+    const double Td = result.ultimate_period / 6.3;
+    return PIDGains { Kp, Kp / Ti, Kp * Td };
+}
+
+/// @brief Gains for loops in velocity form, where the output is changed by FRT::PID's value every tick,
+/// like the speed loops of the motions: there the PID's Kp acts as the integral and its Kd as the proportional gain.
+inline PIDGains incremental_gains (const PIDGains &gains, const double period)
+{
+    return PIDGains { gains.Ki * period, 0, gains.Kp };
+}
+
+/// @brief Gains for FRT::PID used in positional form with a measured rate, the integral is summed every tick.
+inline PIDGains positional_gains (const PIDGains &gains, const double period)
+{
+    return PIDGains { gains.Kp, gains.Ki * period, gains.Kd };
+}
+
+} // namespace
@@ -7,13 +7,14 @@
 #include <type_traits>
 #include <string>
 #include <limits>
+#include <ratio>
 
 using namespace std::chrono_literals;
 
 namespace FRT 
 {
 
-const long double pi = acos(-1);
+constexpr long double pi = 3.141592653589793238462643383279502884L;
 
 template <typename T>
 inline auto clamp (const T &value, const T &min, const T &max)
@@ -39,6 +40,23 @@ inline double time ()
     return (double)ms.count() / 1e6;
 }
 
+/// @brief Compile-time scale of a unit relative to the base unit of its dimension (meter or radian): Ratio * pi^pi_power.
+template <typename Ratio, int pi_power = 0>
+struct Scale
+{
+    static constexpr long double value = [] {
+        long double result = (long double)Ratio::num / Ratio::den;
+        for (int i = 0; i < pi_power; i++) {
+            result *= pi;
+        }
+        return result;
+    }();
+};
+
+/// @brief Multiplier converting values of unit From to unit To, evaluated at compile time.
+template <typename To, typename From>
+inline constexpr double conversion_factor = From::scale::value / To::scale::value;
+
 template <typename T>
 class UnitBase
 {
@@ -47,7 +65,7 @@ class UnitBase
 
         static std::string postfix;
 
-        UnitBase (const long double &value) : value(value) {}
+        constexpr UnitBase (const long double &value) : value(value) {}
 
         UnitBase () = delete;
         UnitBase (const UnitBase &) = default;
@@ -160,14 +178,14 @@ class AngleUnit : public UnitBase<T>
 template <typename T>
 concept Unit = Length<T> || Angle<T>;
 
-class mm : public LengthUnit<mm> { public: using LengthUnit<mm>::LengthUnit; };
-class cm : public LengthUnit<cm> { public: using LengthUnit<cm>::LengthUnit; };
-class dm : public LengthUnit<dm> { public: using LengthUnit<dm>::LengthUnit; };
-class m : public LengthUnit<m> { public: using LengthUnit<m>::LengthUnit; };
+class mm : public LengthUnit<mm> { public: using LengthUnit<mm>::LengthUnit; using scale = Scale<std::milli>; };
+class cm : public LengthUnit<cm> { public: using LengthUnit<cm>::LengthUnit; using scale = Scale<std::centi>; };
+class dm : public LengthUnit<dm> { public: using LengthUnit<dm>::LengthUnit; using scale = Scale<std::deci>; };
+class m : public LengthUnit<m> { public: using LengthUnit<m>::LengthUnit; using scale = Scale<std::ratio<1>>; };
 
-class deg : public AngleUnit<deg> { public: using AngleUnit<deg>::AngleUnit; };
-class rad : public AngleUnit<rad> { public: using AngleUnit<rad>::AngleUnit; };
-class grad : public AngleUnit<grad> { public: using AngleUnit<grad>::AngleUnit; };
+class deg : public AngleUnit<deg> { public: using AngleUnit<deg>::AngleUnit; using scale = Scale<std::ratio<1, 180>, 1>; };
+class rad : public AngleUnit<rad> { public: using AngleUnit<rad>::AngleUnit; using scale = Scale<std::ratio<1>>; };
+class grad : public AngleUnit<grad> { public: using AngleUnit<grad>::AngleUnit; using scale = Scale<std::ratio<1, 200>, 1>; };
 
 // deprecated, will be removed soon
 using _mm = mm;
@@ -189,8 +207,8 @@ template <> std::string UnitBase<grad>::postfix("grad");
 
 namespace unit_literals 
 {
-#define _UNIT_LITERAL(X) X operator"" X (const long double value) { return X(value); } \
-                        X operator"" X (const unsigned long long value) { return X(value); }
+#define _UNIT_LITERAL(X) constexpr X operator"" X (const long double value) { return X(value); } \
+                        constexpr X operator"" X (const unsigned long long value) { return X(value); }
     _UNIT_LITERAL(mm)
     _UNIT_LITERAL(cm)
     _UNIT_LITERAL(dm)
@@ -206,20 +224,9 @@ constexpr inline To angle_cast (const From &angle)
 {
     if constexpr (std::is_same_v<From, To>) {
         return angle;
+    } else {
+        return To(angle.value * conversion_factor<To, From>);
     }
-    if constexpr (std::is_same_v<To, rad>) {
-        // conversions from other units to radian
-        if constexpr (std::is_same_v<From, deg>) return rad(angle.value / 180 * pi);
-        if constexpr (std::is_same_v<From, grad>) return rad(angle.value / 200 * pi);
-    }
-    if constexpr (std::is_same_v<From, rad>) {
-        // conversion from radian to other units
-        if constexpr (std::is_same_v<To, deg>) return deg(angle.value * 180 / pi);
-        if constexpr (std::is_same_v<To, grad>) return grad(angle.value * 200 / pi);
-    }
-    // from a unit to radian to another unit
-    const auto radians = angle_cast<rad>(angle);
-    return angle_cast<To>(radians);
 }
 
 template <Length To, Length From>
@@ -227,54 +234,57 @@ constexpr inline To length_cast (const From &length)
 {
     if constexpr (std::is_same_v<From, To>) {
         return length;
+    } else {
+        return To(length.value * conversion_factor<To, From>);
     }
-    if constexpr (std::is_same_v<To, m>) {
-        // conversions from other units to meter
-        if constexpr (std::is_same_v<From, mm>) return m(length.value / 1000);
-        if constexpr (std::is_same_v<From, cm>) return m(length.value / 100);
-        if constexpr (std::is_same_v<From, dm>) return m(length.value / 10);
-    }
-    if constexpr (std::is_same_v<From, m>) {
-        // conversion from meter to other units
-        if constexpr (std::is_same_v<To, mm>) return mm(length.value * 1000);
-        if constexpr (std::is_same_v<To, cm>) return cm(length.value * 100);
-        if constexpr (std::is_same_v<To, dm>) return dm(length.value * 10);
-    }
-    // from a unit to meters to another unit
-    const auto meters = length_cast<m>(length);
-    return length_cast<To>(meters);
 }
 
+// arc length = angle * diameter / 2
+template <Length To, Angle From, Length Diameter>
+inline constexpr double arc_factor = From::scale::value * Diameter::scale::value / 2 / To::scale::value;
+
+// angle = 2 * arc length / diameter
+template <Angle To, Length From, Length Diameter>
+inline constexpr double angle_factor = 2 * From::scale::value / Diameter::scale::value / To::scale::value;
+
 template <Length To>
 constexpr inline To length_cast (const Angle auto &angle, const Length auto &diameter)
 {
-    const rad radians = angle_cast<rad>(angle);
-    const m diameter_meters = length_cast<m>(diameter);
-    const m arc = radians.value * diameter_meters.value / 2;
-    return length_cast<To>(arc);
+    using A = std::remove_cvref_t<decltype(angle)>;
+    using D = std::remove_cvref_t<decltype(diameter)>;
+    return To(angle.value * diameter.value * arc_factor<To, A, D>);
 }
 
 template <Angle To>
 constexpr inline To angle_cast (const Length auto &arc_length, const Length auto &diameter)
 {
-    const m arc_meters = length_cast<m>(arc_length);
-    const m diameter_meters = length_cast<m>(diameter);
-    const rad radians = 2 * arc_meters.value / diameter_meters.value;
-    return angle_cast<To>(radians);
+    using L = std::remove_cvref_t<decltype(arc_length)>;
+    using D = std::remove_cvref_t<decltype(diameter)>;
+    return To(arc_length.value / diameter.value * angle_factor<To, L, D>);
+}
+
+/// @returns Radians turned by a motor per encoder pulse.
+constexpr inline double radians_per_pulse (const int pulses_per_rotation)
+{
+    return 2 * pi / pulses_per_rotation;
+}
+
+/// @returns Meters travelled by the perimeter of a wheel per encoder pulse.
+constexpr inline double meters_per_pulse (const Length auto &diameter, const int pulses_per_rotation)
+{
+    return pi * length_cast<m>(diameter).value / pulses_per_rotation;
 }
 
 template <Angle To>
 constexpr inline To pulses_to_units (const double pulses, [[maybe_unused]] const Length auto &diameter, const int pulses_per_rotation)
 {
-    const auto radians = rad(2 * pi * pulses / pulses_per_rotation);
-    return angle_cast<To>(radians);
+    return To(pulses * radians_per_pulse(pulses_per_rotation) * conversion_factor<To, rad>);
 }
 
 template <Length To>
 constexpr inline To pulses_to_units (const double pulses, const Length auto &diameter, const int pulses_per_rotation)
 {
-    const auto radians = pulses_to_units<rad>(pulses, diameter, pulses_per_rotation);
-    return length_cast<To>(radians, diameter);
+    return To(pulses * meters_per_pulse(diameter, pulses_per_rotation) * conversion_factor<To, m>);
 }
 
 template <typename To>
@@ -286,14 +296,12 @@ constexpr inline To pulses_to_units (const double pulses, [[maybe_unused]] const
 
 constexpr inline double units_to_pulses (const Angle auto &value, [[maybe_unused]] const Length auto &diameter, const int pulses_per_rotation)
 {
-    const auto radians = angle_cast<rad>(value);
-    return radians.value / pi / 2 * pulses_per_rotation;
+    return angle_cast<rad>(value).value / radians_per_pulse(pulses_per_rotation);
 }
 
 constexpr inline double units_to_pulses (const Length auto &value, const Length auto &diameter, const int pulses_per_rotation)
 {
-    const auto radians = angle_cast<rad>(value, diameter);
-    return units_to_pulses(radians, diameter, pulses_per_rotation);
+    return length_cast<m>(value).value / meters_per_pulse(diameter, pulses_per_rotation);
 }
 
 constexpr inline double units_to_pulses (const double &value, [[maybe_unused]] const Length auto &diameter, [[maybe_unused]] const int pulses_per_rotation)
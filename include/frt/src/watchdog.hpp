@@ -0,0 +1,262 @@
+#pragma once
+
+#include "logger.hpp"
+#include "motor.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace FRT
+{
+
+/// @brief Emergency stop: a high priority thread stops every registered motor when a heartbeat misses its deadline
+/// or Watchdog::trigger is called, e.g. by the back button. Stays tripped until Watchdog::reset.
+class Watchdog
+{
+    public:
+        using clock = std::chrono::steady_clock;
+
+        static constexpr size_t max_motors = 4;
+        static constexpr size_t max_channels = 8;
+
+        /// @brief Heartbeat of a control loop. Times are wrapping microseconds, 32 bit atomics are lock-free on the EV3 too.
+        class Channel
+        {
+            friend class Watchdog;
+
+            private:
+                const char *name = "";
+                // optional, see Watchdog::add_channel
+                TachoMotor *motor = nullptr;
+                std::atomic<uint32_t> last_beat = 0;
+                // zero while disarmed
+                std::atomic<uint32_t> deadline = 0;
+
+            public:
+                void beat ()
+                {
+                    last_beat.store(now(), std::memory_order_relaxed);
+                }
+
+                /// @brief Starts watching, the next beat is due within the deadline.
+                void arm (const std::chrono::microseconds value)
+                {
+                    beat();
+                    deadline.store(value.count(), std::memory_order_release);
+                }
+
+                void disarm ()
+                {
+                    deadline.store(0, std::memory_order_release);
+                }
+        };
+
+        /// @brief Arms a channel for a scope, e.g. a motion.
+        class Guard
+        {
+            private:
+                Channel &channel;
+
+            public:
+                Guard (Channel &channel, const std::chrono::microseconds deadline)
+                : channel(channel)
+                {
+                    channel.arm(deadline);
+                }
+
+                Guard (const Guard &) = delete;
+
+                ~Guard ()
+                {
+                    channel.disarm();
+                }
+        };
+
+    private:
+        const clock::duration period;
+
+        std::array<TachoMotor *, max_motors> motors {};
+        size_t motor_count = 0;
+        std::array<Channel, max_channels> channels;
+        std::atomic<size_t> channel_count = 0;
+
+        std::atomic<bool> tripped = false;
+        std::atomic<const char *> trigger_reason = nullptr;
+        std::atomic<uint32_t> trigger_time = 0;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::atomic<bool> running = false;
+        std::thread thread;
+
+        static uint32_t now ()
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(clock::now().time_since_epoch()).count();
+        }
+
+        /// @param due When the stop was due, to measure the latency.
+        void trip (const char *reason, const uint32_t due)
+        {
+            // stopping first, everything else can wait
+            for (size_t index = 0; index < motor_count; index++) {
+                motors[index]->stop();
+            }
+            const uint32_t latency = now() - due;
+            tripped.store(true, std::memory_order_release);
+
+            Logger::error("Watchdog - emergency stop:", reason, "latency us:", latency);
+        }
+
+        void check ()
+        {
+            // taken even when tripped already, a pending trigger would keep waking the thread
+            const char *reason = trigger_reason.exchange(nullptr, std::memory_order_acquire);
+            if (tripped.load(std::memory_order_acquire)) {
+                return;
+            }
+            if (reason) {
+                trip(reason, trigger_time.load(std::memory_order_relaxed));
+                return;
+            }
+
+            const uint32_t current = now();
+            const size_t count = channel_count.load(std::memory_order_acquire);
+            for (size_t index = 0; index < count; index++) {
+                Channel &channel = channels[index];
+                const uint32_t deadline = channel.deadline.load(std::memory_order_acquire);
+                const uint32_t last_beat = channel.last_beat.load(std::memory_order_relaxed);
+                // wrapping difference, a beat newer than the current time is not late
+                if (deadline != 0 && (int32_t)(current - last_beat) > (int32_t)deadline) {
+                    // a motion nobody waits for is over once its motor stops, checked again a deadline later
+                    // instead of disarming, which could undo a concurrent Channel::arm
+                    if (channel.motor && !channel.motor->is_running()) {
+                        uint32_t expected = last_beat;
+                        channel.last_beat.compare_exchange_strong(expected, current, std::memory_order_relaxed);
+                        continue;
+                    }
+                    trip(channel.name, last_beat + deadline);
+                    return;
+                }
+            }
+        }
+
+        void loop ()
+        {
+            while (running.load(std::memory_order_relaxed)) {
+                {
+                    std::unique_lock lock(mutex);
+                    wake.wait_for(lock, period, [this] {
+                        return trigger_reason.load(std::memory_order_relaxed) != nullptr || !running.load(std::memory_order_relaxed);
+                    });
+                }
+                check();
+            }
+        }
+
+    public:
+        /// @param period Interval of checking the heartbeats, triggers are handled right away.
+        Watchdog (const clock::duration period = std::chrono::milliseconds(5))
+        : period(period)
+        {}
+
+        Watchdog (const Watchdog &) = delete;
+
+        ~Watchdog ()
+        {
+            stop();
+        }
+
+        /// @brief Registers a motor to stop, before Watchdog::start.
+        void add_motor (TachoMotor &motor)
+        {
+            if (motor_count == max_motors) {
+                Logger::error("Watchdog::add_motor - too many motors, increase Watchdog::max_motors");
+                return;
+            }
+            motors[motor_count++] = &motor;
+        }
+
+        /// @brief Adds a heartbeat channel, disarmed until Channel::arm. Add channels from a single thread.
+        /// @param name Reported when it trips, has to outlive the watchdog.
+        /// @param motor Optional, for motions started without waiting for them, e.g. of an arm:
+        /// a missed deadline only trips while the motor is still running, so the channel needs no disarming.
+        Channel &add_channel (const char *name, TachoMotor *motor = nullptr)
+        {
+            const size_t index = channel_count.load(std::memory_order_relaxed);
+            if (index == max_channels) {
+                Logger::error("Watchdog::add_channel - too many channels, increase Watchdog::max_channels");
+                // not watched, so arming it has no effect
+                static Channel spare;
+                return spare;
+            }
+            channels[index].name = name;
+            channels[index].motor = motor;
+            channel_count.store(index + 1, std::memory_order_release);
+            return channels[index];
+        }
+
+        void start ()
+        {
+            if (running.exchange(true)) {
+                return;
+            }
+            thread = std::thread(&Watchdog::loop, this);
+
+            // above every normal thread, so a busy control loop cannot delay the stop
+            sched_param parameters {};
+            parameters.sched_priority = sched_get_priority_max(SCHED_FIFO);
+            if (pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &parameters) != 0) {
+                Logger::warning("Watchdog::start - no real-time priority, running at normal priority");
+            }
+        }
+
+        void stop ()
+        {
+            if (running.exchange(false)) {
+                // taking the lock orders the change before the wait of the thread, so the wakeup is not lost
+                {
+                    const std::scoped_lock lock(mutex);
+                }
+                wake.notify_all();
+                thread.join();
+            }
+        }
+
+        /// @brief Requests an emergency stop, callable from any thread, e.g. a button callback.
+        /// @param reason Reported in the log, has to outlive the watchdog.
+        void trigger (const char *reason)
+        {
+            trigger_time.store(now(), std::memory_order_relaxed);
+            trigger_reason.store(reason, std::memory_order_release);
+            // see Watchdog::stop
+            {
+                const std::scoped_lock lock(mutex);
+            }
+            wake.notify_all();
+        }
+
+        bool is_tripped () const
+        {
+            return tripped.load(std::memory_order_acquire);
+        }
+
+        /// @brief Allows motions again after an emergency stop.
+        void reset ()
+        {
+            const size_t count = channel_count.load(std::memory_order_acquire);
+            for (size_t index = 0; index < count; index++) {
+                channels[index].disarm();
+            }
+            tripped.store(false, std::memory_order_release);
+        }
+};
+
+} // namespace
@@ -0,0 +1,385 @@
+#pragma once
+
+#include "freshness.hpp"
+#include "function.hpp"
+#include "logger.hpp"
+#include "motor.hpp"
+#include "sensor.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace FRT
+{
+
+/// @brief Lock-free queue of a single producer and a single consumer thread, without allocation.
+/// @tparam capacity Power of two, so the indices can wrap around freely.
+template <typename T, size_t capacity>
+class SPSCQueue
+{
+    static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "SPSCQueue - capacity must be a power of two");
+
+    private:
+        std::array<T, capacity> items {};
+        // head is only written by the consumer, tail only by the producer
+        std::atomic<uint32_t> head = 0;
+        std::atomic<uint32_t> tail = 0;
+
+    public:
+        /// @returns False if the queue is full.
+        bool push (T &&item)
+        {
+            const uint32_t position = tail.load(std::memory_order_relaxed);
+            if (position - head.load(std::memory_order_acquire) == capacity) {
+                return false;
+            }
+            items[position % capacity] = std::move(item);
+            tail.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// @returns False if the queue is empty.
+        bool pop (T &item)
+        {
+            const uint32_t position = head.load(std::memory_order_relaxed);
+            if (position == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = std::move(items[position % capacity]);
+            head.store(position + 1, std::memory_order_release);
+            return true;
+        }
+};
+
+/// @brief Latest value of a single writer thread, read by any thread without locking.
+/// A seqlock over 32 bit atomics, since wider ones are not lock-free on the EV3.
+template <typename T>
+class Snapshot
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshot - the value is copied as raw words");
+
+    private:
+        static constexpr size_t words = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+        std::atomic<uint32_t> sequence = 0;
+        std::array<std::atomic<uint32_t>, words> data {};
+
+    public:
+        void store (const T &value)
+        {
+            std::array<uint32_t, words> raw {};
+            std::memcpy(raw.data(), &value, sizeof(T));
+
+            const uint32_t before = sequence.load(std::memory_order_relaxed);
+            sequence.store(before + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t index = 0; index < words; index++) {
+                data[index].store(raw[index], std::memory_order_relaxed);
+            }
+            sequence.store(before + 2, std::memory_order_release);
+        }
+
+        T load () const
+        {
+            std::array<uint32_t, words> raw;
+            while (true) {
+                const uint32_t before = sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    continue;
+                }
+                for (size_t index = 0; index < words; index++) {
+                    raw[index] = data[index].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+
+            T value;
+            std::memcpy(&value, raw.data(), sizeof(T));
+            return value;
+        }
+
+        /// @brief Number of stores so far.
+        uint32_t get_version () const
+        {
+            return sequence.load(std::memory_order_acquire) / 2;
+        }
+};
+
+/// @brief Thread serving a single device: runs the queued commands, then refreshes the device's snapshot, once every period.
+/// Commands and refreshes only run on its thread, so it owns the confined files of the device, see TachoMotorInterface,
+/// and a slow write to one device does not stall the others. Commands posted before DeviceWorker::start wait for it,
+/// a stopped worker does not restart, as a new thread would not own the files.
+/// @tparam capacity Number of commands that can wait, a power of two.
+template <size_t capacity = 16>
+class DeviceWorker
+{
+    public:
+        using clock = std::chrono::steady_clock;
+        using Command = InplaceFunction<void()>;
+
+    private:
+        SPSCQueue<Command, capacity> commands;
+        InplaceFunction<void()> refresh;
+        const clock::duration period;
+
+        std::atomic<bool> running = false;
+        // set by the first refresh, DeviceWorker::start waits for it
+        std::atomic<bool> ready = false;
+        // only used by the thread controlling the worker
+        bool started = false;
+        std::atomic<uint32_t> dropped = 0;
+        std::thread thread;
+
+        void run_commands ()
+        {
+            Command command;
+            while (commands.pop(command)) {
+                command();
+            }
+        }
+
+        void loop ()
+        {
+            auto next = clock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                run_commands();
+                refresh();
+                if (!ready.load(std::memory_order_relaxed)) {
+                    ready.store(true, std::memory_order_release);
+                    ready.notify_one();
+                }
+
+                next += period;
+                std::this_thread::sleep_until(next);
+                // not catching up after a stall, that would only burst sysfs reads
+                const auto now = clock::now();
+                if (now - next > period) {
+                    next = now;
+                }
+            }
+            // commands queued right before stopping, e.g. a final stop, are not lost
+            run_commands();
+        }
+
+    public:
+        /// @param refresh Reads the device into its snapshot, called on the worker thread.
+        /// @param period Interval of the refreshes, queued commands wait at most this long.
+        template <typename Refresh>
+        DeviceWorker (Refresh &&refresh, const clock::duration period = std::chrono::milliseconds(2))
+        : refresh(std::forward<Refresh>(refresh)),
+          period(period)
+        {}
+
+        DeviceWorker (const DeviceWorker &) = delete;
+
+        ~DeviceWorker ()
+        {
+            stop();
+        }
+
+        /// @brief Starts the thread and returns after its first refresh, so the snapshot is valid before the first read.
+        void start ()
+        {
+            if (started) {
+                if (!is_running()) {
+                    Logger::warning("DeviceWorker::start - a stopped worker does not restart");
+                }
+                return;
+            }
+            started = true;
+            running.store(true, std::memory_order_relaxed);
+            thread = std::thread(&DeviceWorker::loop, this);
+            ready.wait(false, std::memory_order_acquire);
+        }
+
+        void stop ()
+        {
+            if (running.exchange(false)) {
+                thread.join();
+            }
+        }
+
+        bool is_running () const
+        {
+            return running.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Queues a command, from the thread controlling the worker, e.g. the control loop.
+        /// @returns False if the queue is full or the worker stopped, and the command was dropped.
+        template <typename Callable>
+        bool post (Callable &&callable)
+        {
+            // after the stop no thread would run it
+            if ((!started || is_running()) && commands.push(Command(std::forward<Callable>(callable)))) {
+                return true;
+            }
+
+            const uint32_t count = dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (count == 1 || count % 100 == 0) {
+                Logger::warning("DeviceWorker::post - queue full or worker stopped, dropped commands:", count);
+            }
+            return false;
+        }
+
+        uint32_t get_dropped () const
+        {
+            return dropped.load(std::memory_order_relaxed);
+        }
+};
+
+/// @brief Optional threaded mode of a TachoMotor, the robot program drives its motors inline. The worker constructs and owns the motor:
+/// setpoints are written by its thread, so the wheels are updated in parallel, and position and speed are read from a snapshot instead of sysfs.
+/// Other threads only reach the motor through MotorWorker::get_motor, for the attributes it shares, e.g. the watchdog stopping it,
+/// its other attributes are confined to the worker, which debug builds assert.
+class MotorWorker
+{
+    public:
+        struct State
+        {
+            int32_t position_pulses;
+            int32_t speed_pulses;
+        };
+
+    private:
+        TachoMotor motor;
+        Snapshot<State> state;
+        DeviceWorker<> worker;
+
+    public:
+        MotorWorker (const std::string_view port, const Unit auto &diameter, const DeviceWorker<>::clock::duration period = std::chrono::milliseconds(2))
+        : motor(port, diameter),
+          worker([this] {
+              state.store(State { this->motor.get_position_pulses(), this->motor.get_speed_pulses() });
+          }, period)
+        {}
+
+        void start ()
+        {
+            worker.start();
+        }
+
+        void stop ()
+        {
+            worker.stop();
+        }
+
+        void set_duty_cycle_setpoint (const int value)
+        {
+            worker.post([this, value] { motor.set_duty_cycle_setpoint(value); });
+        }
+
+        void run_direct ()
+        {
+            worker.post([this] { motor.run_direct(); });
+        }
+
+        /// @brief Stops the motor, not the worker.
+        void stop_motor ()
+        {
+            worker.post([this] { motor.stop(); });
+        }
+
+        /// @param value One of TachoMotor::stop_actions, it has to outlive the command.
+        void set_stop_action (const std::string_view value)
+        {
+            worker.post([this, value] { motor.set_stop_action(value); });
+        }
+
+        State get_state () const
+        {
+            return state.load();
+        }
+
+        int get_position_pulses () const
+        {
+            return state.load().position_pulses;
+        }
+
+        int get_speed_pulses () const
+        {
+            return state.load().speed_pulses;
+        }
+
+        const DeviceWorker<> &get_worker () const
+        {
+            return worker;
+        }
+
+        /// @brief For the shared attributes of the motor, see TachoMotorInterface, e.g. to add it to the watchdog.
+        TachoMotor &get_motor ()
+        {
+            return motor;
+        }
+};
+
+/// @brief Optional threaded mode of a Sensor: its worker reads a mode continuously, readers get the latest values from a snapshot.
+/// The files of sensors lock, see SensorInterface, so the sensor stays usable from other threads, their reads wait for the worker's.
+/// @tparam count Number of values of the mode to read.
+template <size_t count>
+class SensorWorker
+{
+    public:
+        struct State
+        {
+            Reading<std::array<int, count>> reading;
+            // number of new samples so far, a change tells a reader there is a new one
+            uint32_t samples;
+        };
+
+    private:
+        Sensor &sensor;
+        Snapshot<State> state;
+        uint32_t samples = 0;
+        DeviceWorker<> worker;
+
+    public:
+        /// @param mode Mode to read, it has to outlive the worker, e.g. one of the modes of the sensor class.
+        SensorWorker (Sensor &sensor, const std::string_view mode, const DeviceWorker<>::clock::duration period = std::chrono::milliseconds(2))
+        : sensor(sensor),
+          worker([this] {
+              const auto reading = this->sensor.template get_reading<count>();
+              if (reading.fresh) {
+                  samples++;
+              }
+              state.store(State { reading, samples });
+          }, period)
+        {
+            sensor.set_mode(mode);
+        }
+
+        void start ()
+        {
+            worker.start();
+        }
+
+        void stop ()
+        {
+            worker.stop();
+        }
+
+        /// @param mode It has to outlive the command.
+        void set_mode (const std::string_view mode)
+        {
+            worker.post([this, mode] { sensor.set_mode(mode); });
+        }
+
+        State get () const
+        {
+            return state.load();
+        }
+
+        std::array<int, count> get_values () const
+        {
+            return state.load().reading.value;
+        }
+};
+
+} // namespace
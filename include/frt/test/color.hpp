@@ -0,0 +1,62 @@
+#pragma once
+
+#include <frt/src/color.hpp>
+
+#include <cassert>
+#include <vector>
+
+namespace FRT
+{
+
+struct ColorTestSensor
+{
+    std::array<int, 3> next {};
+
+    void set_mode (std::string_view) {}
+
+    template <size_t count>
+    std::array<int, count> get_values ()
+    {
+        return next;
+    }
+};
+
+void color_test ()
+{
+    // nearest calibrated centroid, far readings are unknown
+    ColorClassifier<3, 2> classifier(60);
+    classifier.calibrate(0, { 20, 20, 20 });
+    classifier.calibrate(0, { 22, 18, 20 });
+    classifier.set_reference(1, { 200, 40, 40 });
+    assert(classifier.classify({ 25, 20, 20 }) == 0);
+    assert(classifier.classify({ 190, 50, 40 }) == 1);
+    assert(classifier.classify({ 100, 200, 100 }) == classifier.unknown);
+
+    // hysteresis gives one event per edge
+    EdgeDetector edges;
+    edges.calibrate(60, 660);
+    assert(edges.update(60) == 0);
+    assert(edges.update(300) == 0);
+    assert(edges.update(500) == 1);
+    assert(edges.update(300) == 0 && edges.update(500) == 0);
+    assert(edges.update(200) == -1);
+
+    // the pipeline only reports colors stable for two readings
+    ColorTestSensor sensor;
+
+    std::vector<ColorEvent> events;
+    ColorPipeline<ColorTestSensor, 3, 2> pipeline(sensor, "RGB-RAW", classifier, edges, [&events] (const ColorEvent &event) {
+        events.push_back(event);
+    });
+    for (const auto &values : std::vector<std::array<int, 3>> { { 20, 20, 20 }, { 20, 20, 20 }, { 200, 40, 40 }, { 20, 20, 20 }, { 200, 40, 40 }, { 200, 40, 40 } }) {
+        sensor.next = values;
+        pipeline.poll();
+    }
+
+    assert(events.size() == 2);
+    assert(events[0].type == ColorEvent::Type::color && events[0].to == 0);
+    assert(events[1].from == 0 && events[1].to == 1);
+    assert(pipeline.get_color() == 1);
+}
+
+} // namespace
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <frt/src/coroutine.hpp>
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+namespace FRT
+{
+
+/// @brief Records the destruction of a coroutine frame, e.g. of a cancelled one.
+struct FrameProbe
+{
+    bool &destroyed;
+
+    ~FrameProbe ()
+    {
+        destroyed = true;
+    }
+};
+
+inline Task<> sleep_then_finish (const std::chrono::milliseconds duration, bool &finished, bool &destroyed)
+{
+    const FrameProbe probe { destroyed };
+    co_await sleep_for(duration);
+    finished = true;
+}
+
+inline Task<> tick (const char name, const int count, std::string &trace)
+{
+    for (int index = 0; index < count; index++) {
+        trace += name;
+        co_await next_tick();
+    }
+}
+
+inline Task<> pause (const std::chrono::milliseconds duration)
+{
+    co_await sleep_for(duration);
+}
+
+inline Task<> fail_now ()
+{
+    throw std::runtime_error("child failed");
+    co_return;
+}
+
+inline Task<> finish_now ()
+{
+    co_return;
+}
+
+void coroutine_test ()
+{
+    using namespace std::chrono;
+    using clock = EventLoop::clock;
+
+    EventLoop loop;
+
+    // the first awaitable to complete decides, the sleep does not hold the loop up
+    {
+        int checks = 0;
+        const auto start = clock::now();
+        const size_t index = loop.run(when_any(sleep_for(5s), until([&checks] { return ++checks >= 3; })));
+        assert(index == 1 && checks >= 3);
+        assert(clock::now() - start < 1s);
+    }
+
+    // the loser is cancelled, its frame is destroyed and its waiter unlinked before it would resume
+    {
+        bool winner_finished = false, winner_destroyed = false;
+        bool loser_finished = false, loser_destroyed = false;
+        const size_t index = loop.run(when_any(
+            sleep_then_finish(1ms, winner_finished, winner_destroyed),
+            sleep_then_finish(20ms, loser_finished, loser_destroyed)));
+        assert(index == 0 && winner_finished && winner_destroyed);
+        assert(!loser_finished && loser_destroyed);
+
+        // past the deadline of the loser, nothing resumes its frame
+        loop.run(pause(40ms));
+        assert(!loser_finished);
+    }
+
+    // every task has to complete
+    {
+        bool first_finished = false, first_destroyed = false;
+        bool second_finished = false, second_destroyed = false;
+        const auto start = clock::now();
+        loop.run(when_all(
+            sleep_then_finish(5ms, first_finished, first_destroyed),
+            sleep_then_finish(10ms, second_finished, second_destroyed)));
+        assert(first_finished && second_finished);
+        assert(clock::now() - start >= 10ms);
+    }
+
+    // an exception of the winner reaches the caller, one of a loser finishing meanwhile is logged, not lost
+    {
+        bool caught = false;
+        try {
+            loop.run(when_any(fail_now(), sleep_for(1s)));
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        assert(caught);
+
+        const uint32_t errors = ErrorSignal::count();
+        const size_t index = loop.run(when_any(finish_now(), fail_now()));
+        assert(index == 0 && ErrorSignal::count() == errors + beep_on_error);
+    }
+
+    // when_all rethrows too
+    {
+        bool caught = false;
+        try {
+            loop.run(when_all(finish_now(), fail_now()));
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        assert(caught);
+    }
+
+    // next_tick yields until the next iteration, so coroutines sharing the thread take turns, once per tick each
+    {
+        std::string trace;
+        loop.run(when_all(tick('a', 3, trace), tick('b', 3, trace)));
+        assert(trace.size() == 6);
+        for (size_t index = 0; index < trace.size(); index += 2) {
+            assert(trace[index] != trace[index + 1]);
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <frt/src/file.hpp>
+
+#include <cassert>
+#include <cstdio>
+
+namespace FRT
+{
+
+void file_test ()
+{
+    const std::string path = "/tmp/frt_file_test";
+    std::remove(path.c_str());
+    // files are written from the start like sysfs attributes only when opened fresh, so a file per value
+    {
+        File file(path);
+        assert(file.try_write(42));
+        assert(file.read<int>() == 42);
+    }
+    std::remove(path.c_str());
+    {
+        File file(path);
+        file.write("run-direct holding");
+        const auto words = file.read<std::vector<std::string>>();
+        assert(words.size() == 2 && words[1] == "holding");
+    }
+    std::remove(path.c_str());
+    {
+        // an empty attribute is an empty string, not an error
+        std::ofstream(path).close();
+        File file(path);
+        const auto empty = file.try_read<std::string>();
+        assert(empty && empty->empty());
+        assert(!file.try_read<int>());
+    }
+    std::remove(path.c_str());
+    {
+        // binary reads count the ones returning fewer bytes than asked
+        File file(path);
+        file.write("abc");
+        char buffer[8];
+        assert(file.read_bytes(buffer, 3) == 3);
+        assert(file.read_bytes(buffer, sizeof(buffer), 1) == 2);
+        const auto errors = file.get_errors();
+        assert(errors.short_reads == 1 && errors.read_failures == 0);
+    }
+    std::remove(path.c_str());
+    {
+        UnlockedFile file(path);
+        assert(file.try_write(7) && file.read<int>() == 7);
+    }
+    std::remove(path.c_str());
+    {
+        // a confined file belongs to the first thread using it, not to the one constructing it
+        ConfinedFile file(path);
+        std::thread([&file] {
+            assert(file.try_write(8) && file.read<int>() == 8);
+        }).join();
+    }
+    std::remove(path.c_str());
+
+    // missing files fail after the given attempts, without throwing or blocking
+    File missing("/tmp/frt_file_test_missing/value");
+    const auto result = missing.try_read<int, true>(3);
+    assert(!result && result.error() == IOError::open && result.value_or(-1) == -1);
+    assert((missing.read<int, true>() == 0));
+
+    const auto errors = missing.get_errors();
+    assert(errors.reads == 2 && errors.read_failures == 2 && errors.retries == 3);
+}
+
+} // namespace
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <frt/src/filter.hpp>
+#include <frt/src/fixed.hpp>
+
+#include <cassert>
+#include <cmath>
+
+namespace FRT
+{
+
+void filter_test ()
+{
+    const auto close = [] (const double value, const double reference, const double tolerance) {
+        return std::abs(value - reference) <= tolerance;
+    };
+
+    // ring buffer order
+    RingBuffer<int, 3> ring;
+    for (int value : { 1, 2, 3, 4 }) {
+        ring.push(value);
+    }
+    assert(ring.full() && ring[0] == 2 && ring[2] == 4);
+
+    // median rejects a spike
+    MedianFilter<int, 3> median;
+    assert(median.update(10) == 10);
+    median.update(12);
+    assert(median.update(500) == 12);
+    assert(median.update(11) == 12);
+
+    MedianFilter<Fixed<16>, 3> fixed_median;
+    fixed_median.update(1.5);
+    fixed_median.update(-4);
+    assert(fixed_median.update(2) == Fixed<16>(1.5));
+
+    // ema converges to a step
+    EMAFilter<> ema(0.5);
+    assert(ema.update(4) == 4);
+    assert(ema.update(0) == 2);
+    for (int i = 0; i < 40; i++) {
+        ema.update(10);
+    }
+    assert(close(ema.get(), 10, 1e-6));
+
+    // alpha-beta tracks a ramp
+    AlphaBetaFilter<> alpha_beta(0.5, 0.1);
+    for (int i = 0; i <= 200; i++) {
+        alpha_beta.update(3.0 * i * 0.01, 0.01);
+    }
+    assert(close(alpha_beta.get(), 6, 0.01));
+    assert(close(alpha_beta.get_rate(), 3, 0.01));
+
+    // kalman averages noise around a constant
+    KalmanFilter kalman(0, 1);
+    for (int i = 0; i < 100; i++) {
+        kalman.update(i % 2 ? 9 : 11);
+    }
+    assert(close(kalman.get(), 10, 0.05));
+    assert(kalman.get_variance() < 0.02);
+
+    // least squares derivative of a line, also in fixed-point
+    DerivativeFilter<double, 5> derivative;
+    double slope = 0;
+    for (int i = 0; i < 10; i++) {
+        slope = derivative.update(2.0 * i + (i % 2 ? 0.1 : -0.1), 0.5);
+    }
+    assert(close(slope, 4, 0.1));
+
+    DerivativeFilter<Fixed<16>, 4> fixed_derivative;
+    Fixed<16> fixed_slope = 0;
+    for (int i = 0; i < 4; i++) {
+        fixed_slope = fixed_derivative.update(Fixed<16>(i * 3), Fixed<16>(1));
+    }
+    assert(fixed_slope == Fixed<16>(3));
+}
+
+} // namespace
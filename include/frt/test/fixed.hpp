@@ -0,0 +1,90 @@
+#pragma once
+
+#include <frt/src/control.hpp>
+#include <frt/src/fixed.hpp>
+
+#include <cassert>
+#include <cmath>
+#include <sstream>
+
+namespace FRT 
+{
+
+void fixed_test ()
+{
+    using Q16 = Fixed<16>;
+    using Q28 = Fixed<28>;
+
+    const auto close = [] (const auto fixed, const double reference, const double tolerance) {
+        return fabs((double)fixed - reference) <= tolerance;
+    };
+
+    // conversions
+    static_assert(Q16(1.5).raw == 3 << 15);
+    static_assert(Q16(-2).raw == -2 << 16);
+    assert((int)Q16(2.75) == 2 && (int)Q16(-2.75) == -2);
+    assert(close(Q16(Q28(0.123456)), 0.123456, 1.0 / Q16::one));
+
+    // arithmetic
+    assert(Q16(1.5) + 2 == Q16(3.5));
+    assert(Q16(1.5) - 2 == Q16(-0.5));
+    assert(Q16(1.5) * Q16(-2) == Q16(-3));
+    assert(Q16(-3) / Q16(2) == Q16(-1.5));
+    assert(Q16(3) * 4 / 8 == Q16(1.5));
+    assert(close(Q16(1000) * Q28(0.0008), 0.8, 1e-4));
+    assert(abs(Q16(-4)) == Q16(4));
+
+    // comparisons
+    assert(Q16(0.5) < 1 && 1 > Q16(0.5) && Q16(-1) <= -1);
+
+    // speed pid against the double version
+    {
+        PID<double> reference(0.0008, 0.0000001, 0.00002);
+        PID<Q16, Q28> fixed(0.0008, 0.0000001, 0.00002);
+        double max_error = 0;
+        for (int i = 0; i < 2000; i++) {
+            const double error = 1050 * sin(i / 50.0) + 30 * cos(i / 3.0);
+            const double expected = reference.update(error);
+            const double actual = (double)fixed.update(error);
+            max_error = std::max(max_error, fabs(expected - actual));
+        }
+        assert(max_error < 1e-3);
+    }
+
+    // direction pid with a measured rate against the double version
+    {
+        PID<double> reference(3, 0.01, 0.5);
+        PID<Q16, Q16> fixed(3, 0.01, 0.5);
+        double max_error = 0;
+        for (int i = 0; i < 2000; i++) {
+            const int error = lround(10 * sin(i / 40.0));
+            const int rate = lround(40 * cos(i / 40.0));
+            const double expected = reference.update(error, rate);
+            const double actual = (double)fixed.update(error, rate);
+            max_error = std::max(max_error, fabs(expected - actual));
+        }
+        assert(max_error < 0.5);
+    }
+
+    // motion profile against the double version
+    for (int distance = -100; distance <= 1000; distance += 7) {
+        const double expected = ramp_down<double>(distance, 450, 0.2);
+        assert(close(ramp_down<Q16>(distance, 450, 0.2), expected, 1e-4));
+    }
+
+    // unit conversion of encoder pulses
+    {
+        const double cm_per_pulse = 5 * 3.0 * M_PI / 360;
+        const Q16 fixed_cm_per_pulse = cm_per_pulse;
+        for (int pulses = -3000; pulses <= 3000; pulses += 13) {
+            assert(close(Q16(pulses) * fixed_cm_per_pulse, pulses * cm_per_pulse, 0.05));
+        }
+    }
+
+    // streaming, e.g. into the log
+    std::ostringstream stream;
+    stream << Q16(1.5) << ' ' << Q28(-0.25);
+    assert(stream.str() == "1.5 -0.25");
+}
+
+}; // namespace
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <frt/src/freshness.hpp>
+
+#include <cassert>
+
+namespace FRT
+{
+
+void freshness_test ()
+{
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+
+    // without a period only changes are new
+    FreshnessTracker<int> changes;
+    assert(changes.update(5, start).fresh);
+    assert(!changes.update(5, start + 1ms).fresh);
+    assert(changes.update(6, start + 2ms).fresh);
+
+    // an unchanged value is new again after a period, stamped with the time it was seen
+    FreshnessTracker<int> periodic(10ms);
+    assert(periodic.update(3, start).fresh);
+    const auto repeat = periodic.update(3, start + 4ms);
+    assert(!repeat.fresh && repeat.time == start);
+    assert(periodic.update(3, start + 10ms).fresh);
+
+    // after a reset the next value is new
+    periodic.reset();
+    assert(periodic.update(3, start + 11ms).fresh);
+}
+
+} // namespace
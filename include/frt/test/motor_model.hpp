@@ -0,0 +1,42 @@
+#pragma once
+
+#include <frt/src/motor_model.hpp>
+
+#include <cassert>
+#include <cstdio>
+
+namespace FRT
+{
+
+void motor_model_test ()
+{
+    MotorModel model;
+    assert(!model.valid() && model.duty_for(500, true) == 0);
+
+    model.static_friction = 14;
+    model.deadband = 9;
+    model.speeds = { 0, 20, 120, 220, 320, 420, 520, 620, 720, 820, 920 };
+    assert(model.valid());
+
+    // interpolation between the table points, symmetric in direction
+    assert(model.duty_for(170, true) == 25);
+    assert(model.duty_for(-170, true) == -25);
+    assert(model.duty_for(920, true) == 100);
+    assert(model.duty_for(2000, true) == 100);
+    assert(model.duty_for(0, true) == 0);
+
+    // starting needs the static friction, running only the deadband
+    assert(model.duty_for(10, false) == 14);
+    assert(model.duty_for(10, true) == 9);
+
+    const std::string path = "/tmp/frt_motor_model_test";
+    MotorModel other = model;
+    other.deadband = 3;
+    assert(MotorModel::save(path, std::array<MotorModel, 2> { model, other }));
+    assert(MotorModel::load(path, 0).duty_for(170, true) == 25);
+    assert(MotorModel::load(path, 1).deadband == 3);
+    assert(!MotorModel::load(path, 2).valid());
+    std::remove(path.c_str());
+}
+
+} // namespace
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <frt/src/parameters.hpp>
+
+#include <cassert>
+#include <cstdio>
+#include <thread>
+
+namespace FRT
+{
+
+void parameters_test ()
+{
+    const std::string path = "/tmp/frt_parameters_test";
+    std::remove(path.c_str());
+
+    {
+        ParameterStore parameters(path);
+        assert(parameters.is_open());
+
+        // defaults are registered on first use, but a changed default is not shadowed by the registered one
+        assert(parameters.get("move.Kp", 0.5) == 0.5);
+        assert(parameters.get("move.Kp", 0.75) == 0.75);
+        assert(parameters.set("move.Kp", 0.25));
+        assert(parameters.get("move.Kp", 0.5) == 0.25);
+        assert(!parameters.set("a_name_longer_than_the_slot", 1));
+
+        // resetting returns to the default of the program
+        assert(parameters.set("move.Kd", 2) && parameters.reset("move.Kd"));
+        assert(parameters.get("move.Kd", 1) == 1);
+        assert(!parameters.reset("unknown"));
+    }
+
+    // values survive in the file and are shared between mappings
+    ParameterStore first(path), second(path);
+    assert(first.get("move.Kp", 0.5) == 0.25);
+    second.set("move.Kp", -3);
+    assert(first.get("move.Kp", 0.5) == -3);
+
+    // readers never see a half written value
+    std::thread writer([&second] {
+        for (int i = 0; i < 100000; i++) {
+            second.set("move.Kp", i % 2 ? 1e-300 : -1e300);
+        }
+    });
+    for (int i = 0; i < 100000; i++) {
+        const double value = first.get("move.Kp", 0);
+        assert(value == 1e-300 || value == -1e300 || value == -3);
+    }
+    writer.join();
+
+    int count = 0, overridden = 0;
+    first.for_each([&count, &overridden] (std::string_view, const ParameterStore::Entry entry) {
+        count++;
+        overridden += entry.overridden;
+    });
+    assert(count == 2 && overridden == 1);
+
+    // a writer killed in the middle of a write leaves the sequence odd, readers fall back to the default instead of spinning
+    {
+        const int descriptor = open(path.c_str(), O_RDWR);
+        // the sequence of the first slot, after the format and the count
+        const uint32_t odd = 7;
+        const bool written = pwrite(descriptor, &odd, sizeof(odd), 2 * sizeof(uint32_t)) == sizeof(odd);
+        assert(written);
+        close(descriptor);
+    }
+    assert(first.get("move.Kp", 0.5) == 0.5);
+    assert(!first.set("move.Kp", 1));
+    count = 0;
+    first.for_each([&count] (std::string_view, ParameterStore::Entry) { count++; });
+    assert(count == 1);
+
+    std::remove(path.c_str());
+}
+
+} // namespace
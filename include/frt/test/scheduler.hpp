@@ -0,0 +1,76 @@
+#pragma once
+
+#include <frt/src/scheduler.hpp>
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace FRT
+{
+
+void scheduler_test ()
+{
+    using namespace std::chrono;
+
+    // callables are moved along with their captures and destroyed exactly once
+    auto shared = std::make_shared<int>(3);
+    {
+        InplaceFunction<int(int)> function = [shared] (const int value) { return *shared + value; };
+        assert(function(2) == 5 && shared.use_count() == 2);
+        InplaceFunction<int(int)> moved = std::move(function);
+        assert(!function && moved(4) == 7 && shared.use_count() == 2);
+    }
+    assert(shared.use_count() == 1);
+
+    // the highest priority due task runs first, equal priorities in the order of their release
+    std::vector<int> order;
+    Scheduler<4> scheduler;
+    scheduler.add_task("low", [&order] { order.push_back(0); }, milliseconds::zero(), 0);
+    scheduler.add_task("high", [&order] { order.push_back(2); }, milliseconds::zero(), 2);
+    scheduler.add_task("middle", [&order] { order.push_back(1); }, milliseconds::zero(), 1);
+    scheduler.add_task("later", [&order] { order.push_back(3); }, milliseconds::zero(), 1, milliseconds(20));
+    while (order.size() < 3) {
+        scheduler.step();
+    }
+    assert((order == std::vector<int> { 2, 1, 0 }));
+    // the delayed task is not due yet, the step reports its release
+    assert(scheduler.step() > Scheduler<4>::clock::now());
+    std::this_thread::sleep_for(milliseconds(25));
+    scheduler.step();
+    assert(order.size() == 4 && order.back() == 3);
+
+    // periodic tasks run until they return false
+    int runs = 0;
+    const auto periodic = scheduler.add_task("periodic", [&runs] { return ++runs < 3; }, milliseconds(1));
+    while (runs < 3) {
+        scheduler.step();
+    }
+    assert(scheduler.get_statistics(periodic).runs == 3);
+    assert(!scheduler.cancel(periodic));
+
+    // a stale handle cannot cancel the task that reuses its slot
+    Scheduler<1> single;
+    int first = 0, second = 0;
+    const auto stale = single.add_task("first", [&first] { first++; });
+    single.step();
+    const auto reused = single.add_task("second", [&second] { second++; });
+    assert(reused.valid() && reused.index == stale.index && reused.generation != stale.generation);
+    assert(!single.cancel(stale));
+    single.step();
+    assert(first == 1 && second == 1);
+
+    // cancelled tasks do not run and free their slot
+    const auto cancelled = single.add_task("cancelled", [&first] { first++; });
+    assert(single.cancel(cancelled));
+    assert(!single.cancel(cancelled));
+    single.step();
+    assert(first == 1);
+
+    // a full table rejects new tasks with an invalid handle
+    assert(single.add_task("fills", [] {}, milliseconds(1)).valid());
+    const auto rejected = single.add_task("rejected", [] {});
+    assert(!rejected.valid() && !single.cancel(rejected));
+}
+
+} // namespace
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <frt/src/sound.hpp>
+
+#include <cassert>
+
+namespace FRT
+{
+
+void sound_test ()
+{
+    using namespace std::chrono;
+
+    // queuing returns right away, waiting takes the whole melody, with or without a speaker
+    const auto start = steady_clock::now();
+    Sound::play({ { 440, 30 }, { 0, 10 }, { 880, 30, 10 } });
+    assert(steady_clock::now() - start < 20ms);
+
+    Sound::beep(440, 20);
+    assert(steady_clock::now() - start >= 100ms);
+
+    // a full queue drops tones instead of blocking
+    uint32_t dropped = 0;
+    for (size_t index = 0; index < Sound::Player::capacity + 4; index++) {
+        dropped += Sound::Player::instance().enqueue({ 0, 1 }) == 0;
+    }
+    assert(dropped >= 1);
+}
+
+} // namespace
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <frt/src/tuning.hpp>
+
+#include <cassert>
+#include <cmath>
+
+namespace FRT
+{
+
+void tuning_test ()
+{
+    const auto close = [] (const double value, const double reference, const double tolerance) {
+        return std::abs(value - reference) <= tolerance * std::abs(reference);
+    };
+
+    // identification recovers the simulated model
+    const FirstOrderModel model { .gain = 10, .time_constant = 0.2, .dead_time = 0.02 };
+    SimulatedPlant plant(model);
+    const auto samples = step_response(plant, 50, 2);
+    assert(close(sample_period(samples), 0.005, 0.01));
+
+    const auto identified = identify_first_order(samples, 50);
+    assert(identified);
+    assert(close(identified->gain, 10, 0.01));
+    assert(close(identified->time_constant, 0.2, 0.1));
+    assert(std::abs(identified->dead_time - 0.02) <= 0.01);
+
+    const auto pi = simc(*identified, identified->dead_time);
+    assert(pi.Kp > 0 && pi.Ki > 0 && pi.Kd == 0);
+
+    // relay oscillation of an integrating plant with a lag and dead time,
+    // the ultimate point satisfies K * Ku / (wu * sqrt(1 + (wu * tau)^2)) = 1
+    SimulatedPlant heading({ .gain = 100, .time_constant = 0.05, .dead_time = 0.01 }, 0, true);
+    const auto relay = relay_feedback(heading, 0, 20, 0.5, 4, 10);
+    assert(relay);
+    const double wu = 2 * M_PI / relay->ultimate_period;
+    assert(close(100 * relay->ultimate_gain / (wu * std::sqrt(1 + std::pow(wu * 0.05, 2))), 1, 0.35));
+    assert(close(relay->period, 0.005, 0.01));
+
+    const auto pid = tyreus_luyben(*relay);
+    assert(pid.Kp > 0 && pid.Ki > 0 && pid.Kd > 0);
+
+    // mapping to the per tick gains of FRT::PID
+    const auto incremental = incremental_gains(pi, 0.01);
+    assert(incremental.Kp == pi.Ki * 0.01 && incremental.Kd == pi.Kp);
+    const auto positional = positional_gains(pid, 0.01);
+    assert(positional.Ki == pid.Ki * 0.01 && positional.Kd == pid.Kd);
+
+    // deadband: no response to small inputs
+    SimulatedPlant sticky(model, 5);
+    assert(!identify_first_order(step_response(sticky, 4, 1), 4));
+}
+
+} // namespace
@@ -49,6 +49,12 @@ void units_test ()
     assert(pulses_to_units<deg>(2.5, 20cm, 10) == 90deg);
     assert(pulses_to_units<double>(2.5, 20cm, 10) == 2.5);
 
+    // compile-time conversions
+    static_assert(conversion_factor<cm, m> == 100);
+    static_assert(length_cast<mm>(2dm) == 200mm);
+    static_assert(angle_cast<deg>(rad(pi)) == 180deg);
+    static_assert(units_to_pulses(180deg, 20cm, 360) == 180);
+
     // arithmetic
     assert(-50cm + 2m == 15dm);
     assert(15dm == 2m - 50cm);
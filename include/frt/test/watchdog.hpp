@@ -0,0 +1,49 @@
+#pragma once
+
+#include <frt/src/watchdog.hpp>
+
+#include <cassert>
+
+namespace FRT
+{
+
+void watchdog_test ()
+{
+    using namespace std::chrono;
+
+    Watchdog watchdog(1ms);
+    Watchdog::Channel &loop = watchdog.add_channel("loop");
+    watchdog.start();
+
+    // a beating loop keeps it calm, a disarmed one is not watched
+    {
+        Watchdog::Guard guard(loop, 20ms);
+        for (int index = 0; index < 10; index++) {
+            loop.beat();
+            std::this_thread::sleep_for(2ms);
+        }
+    }
+    std::this_thread::sleep_for(40ms);
+    assert(!watchdog.is_tripped());
+
+    // a missed heartbeat trips it
+    loop.arm(5ms);
+    const auto start = steady_clock::now();
+    while (!watchdog.is_tripped() && steady_clock::now() - start < 1s) {
+        std::this_thread::sleep_for(1ms);
+    }
+    assert(watchdog.is_tripped());
+
+    // and so does a trigger, e.g. the back button
+    watchdog.reset();
+    assert(!watchdog.is_tripped());
+    watchdog.trigger("test");
+    const auto triggered = steady_clock::now();
+    while (!watchdog.is_tripped() && steady_clock::now() - triggered < 1s) {
+        std::this_thread::yield();
+    }
+    assert(watchdog.is_tripped());
+    watchdog.stop();
+}
+
+} // namespace
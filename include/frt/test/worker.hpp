@@ -0,0 +1,64 @@
+#pragma once
+
+#include <frt/src/worker.hpp>
+
+#include <cassert>
+
+namespace FRT
+{
+
+void worker_test ()
+{
+    // fifo order and capacity
+    SPSCQueue<int, 4> queue;
+    for (int value = 0; value < 4; value++) {
+        assert(queue.push(int(value)));
+    }
+    assert(!queue.push(4));
+    int value = -1;
+    assert(queue.pop(value) && value == 0);
+    assert(queue.push(4));
+    for (int expected = 1; expected <= 4; expected++) {
+        assert(queue.pop(value) && value == expected);
+    }
+    assert(!queue.pop(value));
+
+    // snapshots of values wider than a word
+    struct Pair
+    {
+        int64_t first;
+        int32_t second;
+    };
+    Snapshot<Pair> snapshot;
+    snapshot.store(Pair { 1ll << 40, -3 });
+    const Pair pair = snapshot.load();
+    assert(pair.first == 1ll << 40 && pair.second == -3 && snapshot.get_version() == 1);
+
+    // commands wait for the start, then run in order on the worker, and none is lost when stopping
+    std::atomic<int> refreshes = 0;
+    int last = 0;
+    bool ordered = true;
+    DeviceWorker<128> worker([&refreshes] { refreshes++; }, std::chrono::milliseconds(1));
+    worker.post([&last] { last = -1; });
+    assert(last == 0);
+
+    // the first refresh is done when the start returns
+    worker.start();
+    assert(refreshes > 0);
+    for (int index = 1; index <= 100; index++) {
+        const bool posted = worker.post([&last, &ordered, index] {
+            ordered = ordered && last == (index == 1 ? -1 : index - 1);
+            last = index;
+        });
+        assert(posted);
+    }
+    worker.stop();
+    assert(last == 100 && ordered);
+
+    // the thread owned the device, a stopped worker takes no more commands and does not restart
+    const bool late = worker.post([&last] { last = 0; });
+    worker.start();
+    assert(!late && last == 100 && !worker.is_running());
+}
+
+} // namespace
@@ -64,16 +64,18 @@ try:
         ferenc = True
         viktor = True
 
-    if ferenc:
-        os.system("make clean")
-        os.system("FRT_ROBOT_ID=ferenc make")
+    # a single make builds every selected binary from the same tree
+    if ferenc and viktor:
+        os.system("make -j")
+    elif ferenc:
+        os.system("FRT_ROBOT_ID=ferenc make -j")
+    elif viktor:
+        os.system("FRT_ROBOT_ID=viktor make -j")
 
+    if ferenc:
         sync_robot(Ferenc)
 
     if viktor:
-        os.system("make clean")
-        os.system("FRT_ROBOT_ID=viktor make")
-
         sync_robot(Viktor)
 
     robots = []
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "lib.hpp"
+
+#include <optional>
+
+/*
+Autotuning of the motion gains on the table. The robot needs about half a meter of free space ahead and room to turn.
+The gains are written to the parameter store, so they are used from the next motion,
+and they are printed in the form of the profile, to be copied into src/profile.hpp once they are good.
+*/
+
+/// @brief Both wheels driven with the same duty cycle, measuring the average wheel speed in pulses per second.
+/// A tick waits for a new speed sample, as the speed pid of the motions steps once per sample,
+/// so the gains are scaled by the sample period of the motors.
+struct SpeedPlant
+{
+    FreshnessTracker<std::pair<int, int>> speed_freshness {Robot::speed_sample_period};
+
+    SpeedPlant ()
+    {
+        check_emergency_stop();
+
+        left_wheel.set_duty_cycle_setpoint(0);
+        right_wheel.set_duty_cycle_setpoint(0);
+        left_wheel.run_direct();
+        right_wheel.run_direct();
+    }
+
+    ~SpeedPlant ()
+    {
+        left_wheel.stop();
+        right_wheel.stop();
+        while (!wheels_stopped()) {}
+    }
+
+    Sample step (const double input)
+    {
+        left_wheel.set_duty_cycle_setpoint(static_cast<int>(input));
+        right_wheel.set_duty_cycle_setpoint(static_cast<int>(input));
+        while (true) {
+            const auto speeds = speed_freshness.update({ left_wheel.get_speed_pulses(), right_wheel.get_speed_pulses() });
+            if (speeds.fresh) {
+                return Sample { time(), (double)((speeds.value.first + speeds.value.second) / 2) };
+            }
+        }
+    }
+};
+
+/// @brief Turning in place with a duty cycle difference, measuring the heading in degrees.
+/// A positive input turns toward positive angles, the opposite of move's direction correction.
+struct HeadingPlant : public SpeedPlant
+{
+    Sample step (const double input)
+    {
+        left_wheel.set_duty_cycle_setpoint(static_cast<int>(input));
+        right_wheel.set_duty_cycle_setpoint(static_cast<int>(-input));
+        // unused, but move's loop reads them in every iteration, so a tick takes as long as one of its iterations,
+        // the direction pid steps once per iteration and the gains are scaled by the measured tick period
+        (void)left_wheel.get_speed_pulses();
+        (void)right_wheel.get_speed_pulses();
+        return Sample { time(), get_heading().value };
+    }
+};
+
+/// @brief Identifies the speed loop from a step response and the heading loop by relay feedback.
+inline void autotune ()
+{
+    std::optional<PIDGains> speed, heading;
+
+    {
+        SpeedPlant plant;
+        const double input = 50;
+        const auto samples = step_response(plant, input, 1.5);
+        if (const auto model = identify_first_order(samples, input)) {
+            Logger::info("autotune - speed model gain:", model->gain, "time constant:", model->time_constant, "dead time:", model->dead_time);
+            // a closed loop twice as fast as the motor, but not faster than its dead time allows
+            const double closed_loop_time = std::max(model->dead_time, model->time_constant / 2);
+            speed = incremental_gains(simc(*model, closed_loop_time), sample_period(samples));
+        }
+    }
+
+    {
+        HeadingPlant plant;
+        const double setpoint = get_heading().value;
+        if (const auto relay = relay_feedback(plant, setpoint, 30, 1, 4, 10)) {
+            Logger::info("autotune - heading ultimate gain:", relay->ultimate_gain, "period:", relay->ultimate_period);
+            heading = positional_gains(tyreus_luyben(*relay), relay->period);
+        }
+    }
+
+#ifndef FRT_TUNABLE
+    Logger::warning("autotune - gains are not tunable in this build, copy them into the profile");
+#endif
+    if (speed) {
+        parameters.set("move.Kp", speed->Kp);
+        parameters.set("move.Kd", speed->Kd);
+        parameters.set("turn.Kp", speed->Kp);
+        parameters.set("turn.Kd", speed->Kd);
+        parameters.set("turn_control.Kp", speed->Kp);
+        parameters.set("turn_control.Kd", speed->Kd);
+
+        std::cout << "    struct move_control\n    {\n"
+                  << "        static constexpr double Kp = " << speed->Kp << ", Ki = " << speed->Ki << ", Kd = " << speed->Kd << ";\n";
+    }
+    if (heading) {
+        parameters.set("move.Dp", heading->Kp);
+        parameters.set("move.Di", heading->Ki);
+        parameters.set("move.Dd", heading->Kd);
+        parameters.set("turn_control.Dp", heading->Kp);
+        parameters.set("turn_control.Di", heading->Ki);
+        parameters.set("turn_control.Dd", heading->Kd);
+
+        std::cout << "        static constexpr double Dp = " << heading->Kp << ", Di = " << heading->Ki << ", Dd = " << heading->Kd << ";\n    };\n";
+    }
+    std::cout << std::flush;
+
+    if (!speed || !heading) {
+        Logger::error("autotune - identification failed, keeping the previous gains where it did");
+    }
+}
+
+/// @brief Turns in place by a fixed wheel travel and back, measuring the first turn by the G&A angle
+/// and integrating the raw rate of GYRO-FAS over the second, as the sensor reads one mode at a time.
+/// The encoders make both turns the same, so their ratio is the rate scale, sign included.
+/// It is used from the next start of the program.
+inline void calibrate_gyro_scale ()
+{
+    using namespace std::chrono;
+
+    const auto turn_wheels = [] (const int direction) {
+        check_emergency_stop();
+        left_wheel.on_for_segment<false>(direction * 3 * 360deg, 360deg);
+        right_wheel.on_for_segment<false>(-direction * 3 * 360deg, 360deg);
+    };
+    const auto turning = [] {
+        return left_wheel.is_running() || right_wheel.is_running() || !wheels_stopped();
+    };
+
+    sleep(300ms);
+    const double angle_start = gyro.get_angle().value;
+    turn_wheels(1);
+    while (turning()) {}
+    sleep(300ms);
+    const double angle = gyro.get_angle().value - angle_start;
+
+    // the bias of the raw rate, standing still
+    double bias = 0;
+    int count = 0;
+    for (const auto end = steady_clock::now() + 500ms; steady_clock::now() < end; count++) {
+        bias += gyro.get_raw_rate();
+        sleep(2ms);
+    }
+    bias /= count;
+
+    double integral = 0;
+    auto last = steady_clock::now();
+    const auto integrate = [&integral, &last, bias] {
+        const auto now = steady_clock::now();
+        integral += (gyro.get_raw_rate() - bias) * duration<double>(now - last).count();
+        last = now;
+    };
+    turn_wheels(-1);
+    while (turning()) {
+        integrate();
+    }
+    for (const auto end = steady_clock::now() + 300ms; steady_clock::now() < end;) {
+        integrate();
+    }
+    gyro.set_mode(GyroSensor::modes::angle_and_rate);
+
+    Logger::info("calibrate_gyro_scale - G&A turn:", angle, "deg, FAS integral back:", integral, "raw units");
+    if (std::abs(angle) < 90 || std::abs(integral) < 1) {
+        Logger::error("calibrate_gyro_scale - turn too small to measure, keeping the previous scale");
+        return;
+    }
+
+    const double scale = -angle / integral;
+    parameters.set("gyro.rate_scale", scale);
+    std::cout << "    static constexpr double gyro_rate_scale = " << scale << ";" << std::endl;
+}
+
+/// @brief Measures the steady state models of the wheel motors for the feedforward of the drive loops.
+/// They are used from the next start of the program.
+inline void identify_motors ()
+{
+    const auto models = identify_motor_models(left_wheel, right_wheel);
+    MotorModel::save(Robot::motor_models_path, models);
+}
@@ -2,104 +2,197 @@
 
 #include <frt/frt.hpp>
 
-using namespace FRT;
-using namespace FRT::unit_literals;
+#include "profile.hpp"
 
-#if !defined FRT_ROBOT_ID || (FRT_ROBOT_ID != 0) && (FRT_ROBOT_ID != 1)
-#error FRT_ROBOT_ID not defined.
-#endif
+#include <tuple>
 
-GyroSensor gyro(INPUT_1);
+GyroSensor gyro(Robot::ports::gyro);
 
-#if FRT_ROBOT_ID == 0
+TachoMotor left_wheel {Robot::ports::left_wheel, Robot::wheel_diameter};
+TachoMotor right_wheel {Robot::ports::right_wheel, Robot::wheel_diameter};
+TachoMotor arm {Robot::ports::arm, Robot::arm_diameter};
 
-// 5 cm wheels with a gear ratio of 3
-TachoMotor left_wheel {OUTPUT_B, cm(5 * 3.0)};
-TachoMotor right_wheel {OUTPUT_C, cm(5 * 3.0)};
-// gear has 12 teeth, rack has one tooth per 3.2mm
-TachoMotor arm {OUTPUT_A, mm(12.0 * 3.2 / M_PI)};
+// brick LEDs showing the state of the program, see main
+LED led;
+StatusLights status_lights {led};
 
-#else
+// gains and thresholds tunable while the program runs in tuning builds, the profile values are the defaults
+ParameterStore parameters {std::string(Robot::parameters_path)};
+
+// degrees per second per raw unit of GYRO-FAS, measured by calibrate_gyro_scale, zero until then
+const double gyro_rate_scale = parameters.get("gyro.rate_scale", Robot::gyro_rate_scale);
+
+// drift compensated heading, opt-in by a measured rate scale, otherwise the G&A angle of the sensor is the heading
+const bool use_gyro_processor = gyro_rate_scale != 0;
+GyroProcessor gyro_processor {gyro, [] {
+    return left_wheel.get_speed_pulses() == 0 && right_wheel.get_speed_pulses() == 0;
+}, gyro_rate_scale};
+
+/// @brief Applies the poll rates of the profile, before the sensors are first read.
+inline void configure_sensors ()
+{
+    gyro.set_poll_ms(Robot::poll_ms::gyro);
+}
+
+/// @brief Starts the heading source, the robot has to stand still meanwhile.
+inline void start_heading ()
+{
+    if (use_gyro_processor) {
+        gyro_processor.calibrate(500ms);
+        gyro_processor.start();
+    } else {
+        Logger::warning("start_heading - the rate scale of GYRO-FAS is not calibrated, using the G&A angle");
+    }
+}
+
+inline deg get_heading ()
+{
+    return use_gyro_processor ? gyro_processor.get_heading() : gyro.get_angle();
+}
+
+inline GyroSensor::AngleAndRate get_heading_and_rate ()
+{
+    return use_gyro_processor ? gyro_processor.get_heading_and_rate() : gyro.get_angle_and_rate();
+}
+
+/// @brief Makes the current heading the given one, e.g. after aligning to a wall.
+inline void reset_heading (const deg heading = 0)
+{
+    if (use_gyro_processor) {
+        gyro_processor.reset(heading);
+    } else {
+        gyro.reset();
+        gyro.base = gyro.base - heading;
+    }
+}
 
-TachoMotor left_wheel {OUTPUT_C, cm(5 * (36.0 / 20.0))};
-TachoMotor right_wheel {OUTPUT_B, cm(5 * (36.0 / 20.0))};
-TachoMotor arm (OUTPUT_A, cm(0));
+// stops the motors when a control loop stops beating, a turn overruns or the back button is pressed, see start_watchdog
+Watchdog watchdog;
+Watchdog::Channel &loop_heartbeat = watchdog.add_channel("control loop missed its heartbeat");
+Watchdog::Channel &motion_deadline = watchdog.add_channel("motion overran its deadline");
+// arm motions run beside the drive, the deadline only trips while the arm is still running
+Watchdog::Channel &arm_deadline = watchdog.add_channel("arm motion overran its deadline", &arm);
+Buttons buttons;
 
+inline void start_watchdog ()
+{
+    watchdog.add_motor(left_wheel);
+    watchdog.add_motor(right_wheel);
+    watchdog.add_motor(arm);
+    buttons.back.on_press([] {
+        watchdog.trigger("back button");
+    });
+    if (!buttons.is_working()) {
+        Logger::warning("start_watchdog - the buttons cannot be read, no emergency stop by the back button");
+    }
+    watchdog.start();
+}
+
+/// @brief Ends the program once the emergency stop tripped. The motors are stopped already,
+/// every helper starting one calls this first, so the routine cannot drive on after a stop.
+inline void check_emergency_stop ()
+{
+    if (watchdog.is_tripped()) {
+        status_lights.show(StatusLights::patterns::error);
+        Logger::error("Emergency stop, ending the program.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// steady state models of the wheel motors for feedforward, measured by identify_motors()
+MotorModel left_model = MotorModel::load(Robot::motor_models_path, 0);
+MotorModel right_model = MotorModel::load(Robot::motor_models_path, 1);
+
+// number type of the control loops, fixed-point avoids soft-float calls on the EV3
+#ifdef FRT_FIXED_POINT
+using ControlNumber = Fixed<16>;
+#else
+using ControlNumber = double;
 #endif
 
+/// @brief Inputs of the exit conditions and speed controls. Wheel quantities are raw encoder counts,
+/// controls convert their targets to pulses once, when the motion is commanded.
+template <typename Number = ControlNumber>
 struct MoveState
 {
-    double position;
-    double speed;
-    double dir_error;
+    // average travel of the wheels since the start of the motion
+    int position_pulses;
+    // average wheel speed in pulses per second
+    int speed_pulses;
+    // heading error in degrees
+    Number dir_error;
 };
 
+// tuning builds read the gains and thresholds from the parameter store, competition builds (FRT_TUNABLE undefined)
+// use the profile values as constants, which the compiler folds into the controls
+#ifdef FRT_TUNABLE
+inline double tunable (const std::string_view name, const double constant)
+{
+    return parameters.get(name, constant);
+}
+#else
+constexpr double tunable (std::string_view, const double constant)
+{
+    return constant;
+}
+#endif
+
+// controls read their parameters when constructed, so a change takes effect from the next motion
+
+template <typename Profile = Robot>
 struct MoveControl
 {
-    #if FRT_ROBOT_ID == 0
-    const double Kp = 0.0008;
-    const double Ki = 0;
-    const double Kd = 0.00002;
-
-    const double Dp = 3;
-    const double Di = 0.01;
-    const double Dd = 0.5;
-    #else
-    const double Kp = 0.0012;
-    const double Ki = 0;
-    const double Kd = 0.00002;
-
-    const double Dp = 3;
-    const double Di = 0.01;
-    const double Dd = 0.5;
-    #endif
+    const double Kp = tunable("move.Kp", Profile::move_control::Kp);
+    const double Ki = tunable("move.Ki", Profile::move_control::Ki);
+    const double Kd = tunable("move.Kd", Profile::move_control::Kd);
+
+    const double Dp = tunable("move.Dp", Profile::move_control::Dp);
+    const double Di = tunable("move.Di", Profile::move_control::Di);
+    const double Dd = tunable("move.Dd", Profile::move_control::Dd);
 };
 
-struct SegmentControl : public MoveControl
+template <typename Profile = Robot>
+struct SegmentControl : public MoveControl<Profile>
 {
-    int segment_pulses;
+    const int segment_pulses;
+    const int end_threshold_pulses = left_wheel.units_to_pulses(cm(tunable("segment.end_cm", Profile::segment_control::end_threshold.value)));
+    const int target_speed_pulses = left_wheel.units_to_pulses(deg(tunable("segment.speed_deg", Profile::segment_control::target_speed.value)));
+    const double ramp_base = tunable("segment.ramp_base", Profile::segment_control::ramp_base);
 
     SegmentControl (const Unit auto segment)
-    {
-        segment_pulses = left_wheel.units_to_pulses(segment);
-    }
+    : segment_pulses(left_wheel.units_to_pulses(segment))
+    {}
 
-    bool exit_condition (const MoveState &state)
+    template <typename Number>
+    bool exit_condition (const MoveState<Number> &state)
     {
-        return state.position >= segment_pulses;
+        return state.position_pulses >= segment_pulses;
     }
 
-    int speed_control (const MoveState &state)
+    template <typename Number>
+    int speed_control (const MoveState<Number> &state)
     {
-        static const auto end_threshold = left_wheel.units_to_pulses(60cm);
-        static const int target_speed = 1050;
-
-        const int end_distance = segment_pulses - state.position;
-
-        if (end_distance < end_threshold) {
-            #if FRT_ROBOT_ID == 0
-            return target_speed * clamp(0 + (double)end_distance / end_threshold, 0.0, 1.0);
-            #else
-            return target_speed * clamp(0.2 + (double)end_distance / end_threshold, 0.0, 1.0);
-            #endif
-        }
-        else {
-            return target_speed;
+        const int end_distance = segment_pulses - state.position_pulses;
+        if (end_distance >= end_threshold_pulses) {
+            return target_speed_pulses;
         }
+        return static_cast<int>(target_speed_pulses * ramp_down<Number>(end_distance, end_threshold_pulses, ramp_base));
     }
 };
 
-struct SegmentWallbangControl : public SegmentControl
+template <typename Profile = Robot>
+struct SegmentWallbangControl : public SegmentControl<Profile>
 {
-    using SegmentControl::SegmentControl;
+    using SegmentControl<Profile>::SegmentControl;
 
     //double last_speed = 0, avg = 0;
     int cycles = 0;
-    static const int cycles_threshold = 5;
+    const int cycles_threshold = static_cast<int>(tunable("wallbang.cycles", 5));
 
-    bool exit_condition (const MoveState &state)
+    template <typename Number>
+    bool exit_condition (const MoveState<Number> &state)
     {
-        if (state.position >= segment_pulses) {
+        if (state.position_pulses >= this->segment_pulses) {
             return true;
         }
 
@@ -116,15 +209,16 @@ struct SegmentWallbangControl : public SegmentControl
         return false;
 
         /* static const auto threshold = left_wheel.units_to_pulses(5cm);
-        const double acceleration = state.speed - last_speed;
+        const double acceleration = state.speed_pulses - last_speed;
         avg += (1.0 / 20.0) * (acceleration - avg);
-        last_speed = state.speed;
-        return state.position > threshold && (avg <= -2 || state.speed <= 0); */
+        last_speed = state.speed_pulses;
+        return state.position_pulses > threshold && (avg <= -2 || state.speed_pulses <= 0); */
         
     }
 };
 
-struct TimerControl : public MoveControl
+template <typename Profile = Robot>
+struct TimerControl : public MoveControl<Profile>
 {
     const double seconds;
     const double start = time();
@@ -133,32 +227,29 @@ struct TimerControl : public MoveControl
     : seconds(seconds)
     {}
 
-    bool exit_condition ([[maybe_unused]] const MoveState &state)
+    template <typename Number>
+    bool exit_condition ([[maybe_unused]] const MoveState<Number> &state)
     {
         return time() > start + seconds;
     }
 };
 
+template <typename Profile = Robot>
 struct TurnControl
 {
-    #if FRT_ROBOT_ID == 0
-    const double Kp = 0;
-    const double Ki = 0;
-    const double Kd = 0;
-    #else
-    const double Kp = 0;
-    const double Ki = 0;
-    const double Kd = 0;
-    #endif
+    const double Kp = tunable("turn_control.Kp", Profile::turn_control::Kp);
+    const double Ki = tunable("turn_control.Ki", Profile::turn_control::Ki);
+    const double Kd = tunable("turn_control.Kd", Profile::turn_control::Kd);
 
-    const double Dp = 0.5;
-    const double Di = 0.01;
-    const double Dd = 0.1;
+    const double Dp = tunable("turn_control.Dp", Profile::turn_control::Dp);
+    const double Di = tunable("turn_control.Di", Profile::turn_control::Di);
+    const double Dd = tunable("turn_control.Dd", Profile::turn_control::Dd);
 
     int cycles = 0;
-    static const int cycles_threshold = 10;
+    const int cycles_threshold = static_cast<int>(tunable("turn_control.cycles", 10));
 
-    bool exit_condition (const MoveState &state) 
+    template <typename Number>
+    bool exit_condition (const MoveState<Number> &state) 
     {
         if (abs(state.dir_error) <= 2) {
             cycles++;
@@ -172,14 +263,26 @@ struct TurnControl
         return false;
     }
 
-    int speed_control ([[maybe_unused]] const MoveState &state) 
+    template <typename Number>
+    int speed_control ([[maybe_unused]] const MoveState<Number> &state) 
     {
         return 0;
     }
 };
 
+inline bool wheels_stopped ()
+{
+    return left_wheel.get_speed_pulses() == 0 && right_wheel.get_speed_pulses() == 0;
+}
+
+template <typename Number = ControlNumber, typename Profile = Robot>
 inline void move (const int direction, const Angle auto target_angle, auto control)
 {
+    using SpeedGain = GainType<Number, 28>;
+    using DirectionGain = GainType<Number, 16>;
+
+    check_emergency_stop();
+
     left_wheel.set_duty_cycle_setpoint(0);
     right_wheel.set_duty_cycle_setpoint(0);
 
@@ -189,38 +292,56 @@ inline void move (const int direction, const Angle auto target_angle, auto contr
     left_wheel.set_stop_action(TachoMotor::stop_actions::brake);
     right_wheel.set_stop_action(TachoMotor::stop_actions::brake);
 
-    const double left_start = left_wheel.get_position<deg>().value * direction;
-    const double right_start = right_wheel.get_position<deg>().value * direction;
+    // everything wheel related stays in encoder pulses, only the heading is in degrees
+    const int left_start = left_wheel.get_position_pulses();
+    const int right_start = right_wheel.get_position_pulses();
 
-    // high baseline sp, will not start without it
-    double sp = 35, last_error = 0, error_sum = 0;
+    PID<Number, SpeedGain> speed_pid(control.Kp, control.Ki, control.Kd);
+    PID<Number, DirectionGain> direction_pid(control.Dp, control.Di, control.Dd);
 
-    const double target_deg = angle_cast<deg>(target_angle).value;
-    double dir_error_sum = 0;
+    // with identified motor models the feedforward does the heavy lifting and sp only holds the feedback,
+    // otherwise it needs a high baseline, will not start without it
+    const bool feedforward = left_model.valid() && right_model.valid();
+    Number sp = feedforward ? 0 : 35;
+    const Number limit = 100;
+
+    const Number target_deg = angle_cast<deg>(target_angle).value;
 
     // static correction
+    const Number left_corr = Profile::left_wheel_correction, right_corr = Profile::right_wheel_correction;
+
+    // the speed attribute has single tick spikes
+    MedianFilter<int, 3> speed_filter;
+    // the loop is faster than the speed attribute updates, the speed pid only steps on new samples
+    FreshnessTracker<std::pair<int, int>> speed_freshness(Profile::speed_sample_period);
+    int speed = 0;
 
-    #if FRT_ROBOT_ID == 0
-    const double left_corr = 1, right_corr = 1;
-    #else
-    const double left_corr = 1, right_corr = 1;
-    #endif
+    loop_heartbeat.arm(Profile::safety::loop_deadline);
 
     while (true) {
-        const double left_pos = (direction * left_wheel.get_position<deg>().value) - left_start;
-        const double right_pos = (direction * right_wheel.get_position<deg>().value) - right_start;
+        loop_heartbeat.beat();
+        // the motors are stopped already
+        if (watchdog.is_tripped()) {
+            break;
+        }
+
+        const int left_pos = direction * (left_wheel.get_position_pulses() - left_start);
+        const int right_pos = direction * (right_wheel.get_position_pulses() - right_start);
 
         // exit conditions
 
-        const double position = (left_pos + right_pos) / 2;
-        const double speed = (left_wheel.get_speed<deg>().value + right_wheel.get_speed<deg>().value) / 2 * direction;
+        const int position = (left_pos + right_pos) / 2;
+        const auto speeds = speed_freshness.update({ left_wheel.get_speed_pulses(), right_wheel.get_speed_pulses() });
+        if (speeds.fresh) {
+            speed = speed_filter.update((speeds.value.first + speeds.value.second) / 2 * direction);
+        }
 
-        const auto gyro_state = gyro.get_angle_and_rate();
-        const double dir_error = gyro_state.angle.value - target_deg;
+        const auto gyro_state = get_heading_and_rate();
+        const Number dir_error = Number(gyro_state.angle.value) - target_deg;
 
-        MoveState state {
-            .position = position,
-            .speed = speed,
+        MoveState<Number> state {
+            .position_pulses = position,
+            .speed_pulses = speed,
             .dir_error = dir_error
         };
 
@@ -230,77 +351,114 @@ inline void move (const int direction, const Angle auto target_angle, auto contr
             break;
         }
 
-        // speed pidconst double Kp = 0.008, Ki = 0.00000007, Kd = 0.00002;
+        // speed pid
 
         const int target_speed = control.speed_control(state);
-        //Logger::info(target_speed);
-        const double speed_error = speed - target_speed;
+        if (speeds.fresh) {
+            sp = clamp(sp - speed_pid.update(Number(speed - target_speed)), -limit, limit);
+        }
 
-        const double correction = speed_error * control.Kp + error_sum * control.Ki + (speed_error - last_error) * control.Kd;
-        sp = clamp(sp - correction, -100.0, 100.0);
-        last_error = speed_error;
-        error_sum += speed_error;
+        const Number left_ff = left_model.duty_for(target_speed, speed != 0);
+        const Number right_ff = right_model.duty_for(target_speed, speed != 0);
 
         // direction pid
 
-        const double dir_correction = dir_error * control.Dp + dir_error_sum * control.Di + gyro_state.rate.value * control.Dd;
-        dir_error_sum += dir_error;
+        const Number dir_correction = direction_pid.update(dir_error, Number(gyro_state.rate.value));
 
         // calculating duty cycle setpoint
 
-        const double left_sp = clamp(sp - direction * dir_correction, -100.0, 100.0);
-        const double right_sp = clamp(sp + direction * dir_correction, -100.0, 100.0);
+        const Number left_sp = clamp(left_ff + sp - dir_correction * direction, -limit, limit);
+        const Number right_sp = clamp(right_ff + sp + dir_correction * direction, -limit, limit);
 
-        sp = (left_sp + right_sp) / 2;
+        sp = (left_sp + right_sp - left_ff - right_ff) / 2;
 
         // updating motors
 
-        left_wheel.set_duty_cycle_setpoint(left_sp * left_corr * direction);
-        right_wheel.set_duty_cycle_setpoint(right_sp * right_corr * direction);
-        //Logger::info(dir_error, left_sp * left_corr * direction, right_sp * right_corr * direction);
+        left_wheel.set_duty_cycle_setpoint(static_cast<int>(left_sp * left_corr * direction));
+        right_wheel.set_duty_cycle_setpoint(static_cast<int>(right_sp * right_corr * direction));
 
         Logger::info(dir_error);
     }
 
-    while (left_wheel.get_speed() != 0cm || right_wheel.get_speed() != 0cm) {}
+    loop_heartbeat.disarm();
+    check_emergency_stop();
+
+    while (!wheels_stopped()) {}
 }
 
-inline void turn (const Angle auto target_angle)
+/// @brief Turning in place to an absolute heading, split into steps so it can be driven by a blocking loop or a coroutine.
+template <typename Number = ControlNumber, typename Profile = Robot>
+struct TurnMotion
 {
-    left_wheel.set_duty_cycle_setpoint(0);
-    right_wheel.set_duty_cycle_setpoint(0);
+    using Gain = GainType<Number, 28>;
+
+    // read when the turn starts
+    const Gain Kp = tunable("turn.Kp", Profile::turn_motion::Kp);
+    const Gain Ki = tunable("turn.Ki", Profile::turn_motion::Ki);
+    const Gain Kd = tunable("turn.Kd", Profile::turn_motion::Kd);
+    const Number sp_limit = tunable("turn.sp_limit", Profile::turn_motion::sp_limit);
+    const deg max_speed = tunable("turn.max_speed_deg", Profile::turn_motion::max_speed.value);
+    const Number base_speed_target = tunable("turn.base_speed", Profile::turn_motion::base_speed_target);
+    const int cycles_threshold = static_cast<int>(tunable("turn.cycles", 5));
+
+    Number dir_end;
+    int direction;
+    // wheel speeds are controlled in pulses per second
+    const Number max_speed_target = left_wheel.units_to_pulses(max_speed);
+    Number speed_target = max_speed_target;
+    int cycles = 0;
+    Number left_sp, right_sp, left_last = 0, right_last = 0;
+    // the wheel pids only step on new speed samples, a repeat would zero the derivative and count the error twice
+    FreshnessTracker<std::pair<int, int>> speed_freshness {Profile::speed_sample_period};
+    // integral terms, already multiplied by Ki
+    Gain left_sum = 0, right_sum = 0;
+    bool stopped = false;
+
+    TurnMotion (const Angle auto target_angle)
+    {
+        check_emergency_stop();
 
-    left_wheel.run_direct();
-    right_wheel.run_direct();
+        left_wheel.set_duty_cycle_setpoint(0);
+        right_wheel.set_duty_cycle_setpoint(0);
 
-    left_wheel.set_stop_action(TachoMotor::stop_actions::brake);
-    right_wheel.set_stop_action(TachoMotor::stop_actions::brake);
+        left_wheel.run_direct();
+        right_wheel.run_direct();
 
-    const double dir_end = angle_cast<deg>(target_angle).value;
-    const double dir_start = gyro.get_angle().value;
-    const int direction = (dir_end - dir_start > 0) ? 1 : -1;
+        left_wheel.set_stop_action(TachoMotor::stop_actions::brake);
+        right_wheel.set_stop_action(TachoMotor::stop_actions::brake);
 
-    #if FRT_ROBOT_ID == 0
-    const double Kp = 0.008, Ki = 0.00000007, Kd = 0.00002;
-    const double sp_limit = 70;
-    const double max_speed_target = 200;
-    const double base_speed_target = 0.2;
-    #else
-    const double Kp = 0.008, Ki = 0.0000001, Kd = 0.00003;
-    const double sp_limit = 100;
-    const double max_speed_target = 320;
-    const double base_speed_target = 0.1;
-    #endif
+        dir_end = angle_cast<deg>(target_angle).value;
+        const Number dir_start = get_heading().value;
+        direction = (dir_end - dir_start > 0) ? 1 : -1;
 
-    double speed_target = max_speed_target;
+        // starting just above the static friction when it is known
+        left_sp = (left_model.valid() ? left_model.static_friction : 20) * direction;
+        right_sp = -(right_model.valid() ? right_model.static_friction : 20) * direction;
 
-    int cycles = 0;
-    static const int cycles_threshold = 5;
+        // a stalled turn never reaches its heading, the deadline stops it
+        loop_heartbeat.arm(Profile::safety::loop_deadline);
+        motion_deadline.arm(Profile::safety::turn_deadline);
+    }
 
-    double left_sp = 20 * direction, right_sp = -20 * direction, left_sum = 0, left_last = 0, right_sum = 0, right_last = 0;
+    TurnMotion (const TurnMotion &) = delete;
 
-    while (cycles < cycles_threshold) {
-        const double distance = (dir_end - gyro.get_angle().value) * direction;
+    // a turn cancelled midway must not leave the wheels running
+    ~TurnMotion ()
+    {
+        stop();
+    }
+
+    /// @brief One control iteration.
+    /// @returns True once the heading is reached.
+    bool step ()
+    {
+        loop_heartbeat.beat();
+        // the motors are stopped already
+        if (watchdog.is_tripped()) {
+            return true;
+        }
+
+        const Number distance = (dir_end - Number(get_heading().value)) * direction;
 
         if (abs(distance) <= 1) {
             cycles++;
@@ -310,40 +468,78 @@ inline void turn (const Angle auto target_angle)
         }
 
         if (distance < 60) {
-            speed_target = max_speed_target * clamp((distance > 0 ? 1 : -1) * base_speed_target + distance / 60, -1.0, 1.0);
+            speed_target = max_speed_target * clamp<Number>((distance > 0 ? 1 : -1) * base_speed_target + distance / 60, -1, 1);
         }
 
-        const double left_speed = left_wheel.get_speed<deg>().value * direction;
-        const double right_speed = right_wheel.get_speed<deg>().value * direction;
+        const auto speeds = speed_freshness.update({ left_wheel.get_speed_pulses(), right_wheel.get_speed_pulses() });
+        if (!speeds.fresh) {
+            return cycles >= cycles_threshold;
+        }
 
-        const double left_error = left_speed - speed_target;
-        const double right_error = right_speed - (-speed_target);
+        const Number left_speed = speeds.value.first * direction;
+        const Number right_speed = speeds.value.second * direction;
 
-        const double left_correction = left_error * Kp + left_sum * Ki + (left_error - left_last) * Kd;
-        const double right_correction = right_error * Kp + right_sum * Ki + (right_error - right_last) * Kd;
+        const Number left_error = left_speed - speed_target;
+        const Number right_error = right_speed - (-speed_target);
+
+        const Number left_correction = left_error * Kp + Number(left_sum) + (left_error - left_last) * Kd;
+        const Number right_correction = right_error * Kp + Number(right_sum) + (right_error - right_last) * Kd;
 
         left_last = left_speed;
         right_last = right_speed;
-        left_sum += left_speed;
-        right_sum += right_speed;
+        left_sum += Ki * left_speed;
+        right_sum += Ki * right_speed;
 
         left_sp = clamp(left_sp - left_correction, -sp_limit, sp_limit);
         right_sp = clamp(right_sp - right_correction, -sp_limit, sp_limit);
 
-        left_wheel.set_duty_cycle_setpoint(left_sp * direction);
-        right_wheel.set_duty_cycle_setpoint(right_sp * direction);
+        left_wheel.set_duty_cycle_setpoint(static_cast<int>(left_sp * direction));
+        right_wheel.set_duty_cycle_setpoint(static_cast<int>(right_sp * direction));
 
         //Logger::info(distance, speed_target);
+
+        return cycles >= cycles_threshold;
     }
 
-    left_wheel.stop();
-    right_wheel.stop();
+    void stop ()
+    {
+        if (!stopped) {
+            left_wheel.stop();
+            right_wheel.stop();
+            loop_heartbeat.disarm();
+            motion_deadline.disarm();
+            stopped = true;
+        }
+    }
+};
+
+inline void turn (const Angle auto target_angle)
+{
+    TurnMotion<> motion(target_angle);
+    while (!motion.step()) {}
+    motion.stop();
+    check_emergency_stop();
+
+    while (!wheels_stopped()) {}
+}
+
+/// @brief Coroutine version of turn, to be run by an FRT::EventLoop, e.g. co_await when_any(turn_to(90deg), sleep_for(2s)).
+inline Task<> turn_to (const Angle auto target_angle)
+{
+    TurnMotion<> motion(target_angle);
+    while (!motion.step()) {
+        co_await next_tick();
+    }
+    motion.stop();
+    check_emergency_stop();
 
-    while (left_wheel.get_speed() != 0cm || right_wheel.get_speed() != 0cm) {}
+    co_await until(wheels_stopped);
 }
 
 inline void steer_around_left (const Angle auto target_angle)
 {
+    check_emergency_stop();
+
     left_wheel.set_stop_action(TachoMotor::stop_actions::hold);
     left_wheel.stop();
 
@@ -353,10 +549,10 @@ inline void steer_around_left (const Angle auto target_angle)
     right_wheel.set_stop_action(TachoMotor::stop_actions::brake);
 
     const double dir_end = angle_cast<deg>(target_angle).value;
-    const double dir_start = gyro.get_angle().value;
+    const double dir_start = get_heading().value;
     const int direction = (dir_end - dir_start > 0) ? 1 : -1;
 
-    const double max_speed_target = 400;
+    const double max_speed_target = right_wheel.units_to_pulses(400deg);
     double speed_target = max_speed_target;
 
     int cycles = 0;
@@ -366,8 +562,18 @@ inline void steer_around_left (const Angle auto target_angle)
 
     const double Kp = 0.008, Ki = 0.00000007, Kd = 0.00002;
 
+    // a stalled steer never reaches its heading, the deadline stops it
+    loop_heartbeat.arm(Robot::safety::loop_deadline);
+    motion_deadline.arm(Robot::safety::turn_deadline);
+
     while (cycles < cycles_threshold) {
-        const double distance = (dir_end - gyro.get_angle().value) * direction;
+        loop_heartbeat.beat();
+        // the motors are stopped already
+        if (watchdog.is_tripped()) {
+            break;
+        }
+
+        const double distance = (dir_end - get_heading().value) * direction;
 
         if (abs(distance) <= 1) {
             cycles++;
@@ -380,7 +586,7 @@ inline void steer_around_left (const Angle auto target_angle)
             speed_target = max_speed_target * clamp(0.2 + distance / 60, 0.0, 1.0);
         }
 
-        const double right_speed = right_wheel.get_speed<deg>().value * direction;
+        const double right_speed = right_wheel.get_speed_pulses() * direction;
         const double right_error = right_speed - (-speed_target);
         const double right_correction = right_error * Kp + right_sum * Ki + (right_error - right_last) * Kd;
 
@@ -395,12 +601,17 @@ inline void steer_around_left (const Angle auto target_angle)
     }
 
     right_wheel.stop();
+    loop_heartbeat.disarm();
+    motion_deadline.disarm();
+    check_emergency_stop();
 
-    while (left_wheel.get_speed() != 0cm || right_wheel.get_speed() != 0cm) {}
+    while (!wheels_stopped()) {}
 }
 
 inline void steer_around_right (const Angle auto target_angle)
 {
+    check_emergency_stop();
+
     right_wheel.set_stop_action(TachoMotor::stop_actions::hold);
     right_wheel.stop();
 
@@ -410,10 +621,10 @@ inline void steer_around_right (const Angle auto target_angle)
     left_wheel.set_stop_action(TachoMotor::stop_actions::brake);
     
     const double dir_end = angle_cast<deg>(target_angle).value;
-    const double dir_start = gyro.get_angle().value;
+    const double dir_start = get_heading().value;
     const int direction = (dir_end - dir_start > 0) ? 1 : -1;
 
-    const double max_speed_target = 200;
+    const double max_speed_target = left_wheel.units_to_pulses(200deg);
     double speed_target = max_speed_target;
 
     int cycles = 0;
@@ -423,8 +634,18 @@ inline void steer_around_right (const Angle auto target_angle)
 
     const double Kp = 0.008, Ki = 0.00000007, Kd = 0.00002;
 
+    // a stalled steer never reaches its heading, the deadline stops it
+    loop_heartbeat.arm(Robot::safety::loop_deadline);
+    motion_deadline.arm(Robot::safety::turn_deadline);
+
     while (cycles < cycles_threshold) {
-        const double distance = (dir_end - gyro.get_angle().value) * direction;
+        loop_heartbeat.beat();
+        // the motors are stopped already
+        if (watchdog.is_tripped()) {
+            break;
+        }
+
+        const double distance = (dir_end - get_heading().value) * direction;
 
         if (abs(distance) <= 1) {
             cycles++;
@@ -437,7 +658,7 @@ inline void steer_around_right (const Angle auto target_angle)
             speed_target = max_speed_target * clamp(0.2 + distance / 60, 0.0, 1.0);
         }
 
-        const double left_speed = left_wheel.get_speed<deg>().value * direction;
+        const double left_speed = left_wheel.get_speed_pulses() * direction;
         const double left_error = left_speed - speed_target;
         const double left_correction = left_error * Kp + left_sum * Ki + (left_error - left_last) * Kd;
 
@@ -452,43 +673,130 @@ inline void steer_around_right (const Angle auto target_angle)
     }
 
     left_wheel.stop();
+    loop_heartbeat.disarm();
+    motion_deadline.disarm();
+    check_emergency_stop();
 
-    while (left_wheel.get_speed() != 0cm || right_wheel.get_speed() != 0cm) {}
+    while (!wheels_stopped()) {}
 }
 
-inline void move_segment (const Unit auto segment, const Angle auto target_angle) 
+/// @brief Runs an action once the motion it is attached to gets within a given distance of its end.
+/// Fires at the end of the motion at the latest, so the action is never skipped.
+template <typename Action>
+struct DistanceTrigger
+{
+    const int remaining_pulses;
+    Action action;
+    bool fired = false;
+
+    template <typename Number>
+    void update (const MoveState<Number> &state, const int segment_pulses)
+    {
+        if (!fired && segment_pulses - state.position_pulses <= remaining_pulses) {
+            fired = true;
+            action();
+        }
+    }
+
+    void finish ()
+    {
+        if (!fired) {
+            fired = true;
+            action();
+        }
+    }
+};
+
+/// @brief Attaches an action to a motion, e.g. move_segment(50cm, 0deg, when_remaining(10cm, lift_up<false>)).
+/// The action should not block, use the non-blocking motor commands and join_arm() later.
+inline auto when_remaining (const Unit auto distance, auto action)
+{
+    return DistanceTrigger<decltype(action)> { left_wheel.units_to_pulses(distance), action };
+}
+
+template <typename Control, typename... Triggers>
+struct TriggeredControl : public Control
+{
+    std::tuple<Triggers...> triggers;
+
+    TriggeredControl (const Control &control, const Triggers &...triggers)
+    : Control(control), 
+      triggers(triggers...)
+    {}
+
+    template <typename Number>
+    bool exit_condition (const MoveState<Number> &state)
+    {
+        std::apply([&] (auto &...trigger) { (trigger.update(state, this->segment_pulses), ...); }, triggers);
+
+        if (!Control::exit_condition(state)) {
+            return false;
+        }
+
+        std::apply([] (auto &...trigger) { (trigger.finish(), ...); }, triggers);
+        return true;
+    }
+};
+
+inline void move_segment (const Unit auto segment, const Angle auto target_angle, const auto &...triggers) 
 {
     const int direction = (segment.value > 0) ? 1 : -1;
-    SegmentControl control(direction * segment);
-    move(direction, target_angle, control);
+    SegmentControl<> control(direction * segment);
+    move(direction, target_angle, TriggeredControl(control, triggers...));
 }
 
-inline void move_wallbang (const Unit auto segment, const Angle auto target_angle)
+inline void move_wallbang (const Unit auto segment, const Angle auto target_angle, const auto &...triggers)
 {
     const int direction = (segment.value > 0) ? 1 : -1;
-    SegmentWallbangControl control(direction * segment);
-    move(direction, target_angle, control);
+    SegmentWallbangControl<> control(direction * segment);
+    move(direction, target_angle, TriggeredControl(control, triggers...));
 }
 
+// only the first lift is short, one flag for the blocking and the non-blocking lifts
+inline bool arm_lifted_once = false;
+
+template <bool block = true>
 inline void lift_up ()
 {
-    static bool first = true;
-    if (first) {
-        arm.on_for_segment(2 * 360deg, 1050deg);
-        first = false;
+    check_emergency_stop();
+    // a stalled arm keeps pushing, the deadline stops it
+    arm_deadline.arm(Robot::safety::arm_deadline);
+
+    if (!arm_lifted_once) {
+        arm.on_for_segment<block>(2 * 360deg, 1050deg);
+        arm_lifted_once = true;
     }
     else {
-        arm.on_for_segment(4 * 360deg, 1050deg);
+        arm.on_for_segment<block>(4 * 360deg, 1050deg);
+    }
+
+    if constexpr (block) {
+        arm_deadline.disarm();
+        check_emergency_stop();
     }
 }
 
 inline void lift_down ()
 {
+    check_emergency_stop();
+    arm_deadline.arm(Robot::safety::arm_deadline);
     arm.on_for_segment<false, true>(-4 * 360deg, 300deg);
 }
 
+/// @brief Waits for the last arm motion started without blocking.
+inline void join_arm ()
+{
+    arm.wait_while(TachoMotor::states::running);
+    arm_deadline.disarm();
+    check_emergency_stop();
+}
+
 inline void unregulated_move (const int sp, const auto duration)
 {
+    check_emergency_stop();
+    // there is no loop to beat, the whole motion has a deadline instead
+    motion_deadline.arm(duration + Robot::safety::loop_deadline);
+
     left_wheel.set_duty_cycle_setpoint(sp);
     right_wheel.set_duty_cycle_setpoint(sp);
     left_wheel.run_direct();
@@ -501,4 +809,74 @@ inline void unregulated_move (const int sp, const auto duration)
 
     left_wheel.stop();
     right_wheel.stop();
+    motion_deadline.disarm();
+    check_emergency_stop();
+}
+
+/// @brief Drives both wheels at a fixed duty cycle until neither of them moves anymore, e.g. when aligning against a wall.
+/// @param timeout Upper bound of the motion, in case the wheels never settle.
+/// @returns The time the motion actually took.
+inline auto unregulated_move_until_settled (const int sp, const auto timeout)
+{
+    using namespace std::chrono;
+
+    // a wheel counts as settled if it turned less than this during the last window
+    static const int settle_pulses = left_wheel.units_to_pulses(3deg);
+    static const auto settle_window = 60ms;
+    static const auto sample_period = 5ms;
+
+    check_emergency_stop();
+
+    left_wheel.set_duty_cycle_setpoint(sp);
+    right_wheel.set_duty_cycle_setpoint(sp);
+    left_wheel.run_direct();
+    right_wheel.run_direct();
+
+    left_wheel.set_stop_action(TachoMotor::stop_actions::brake);
+    right_wheel.set_stop_action(TachoMotor::stop_actions::brake);
+
+    const auto start = steady_clock::now();
+    const auto deadline = start + timeout;
+
+    loop_heartbeat.arm(Robot::safety::loop_deadline);
+    motion_deadline.arm(timeout + Robot::safety::loop_deadline);
+
+    auto window_start = start;
+    int left_window_start = left_wheel.get_position_pulses();
+    int right_window_start = right_wheel.get_position_pulses();
+
+    while (steady_clock::now() < deadline) {
+        sleep(sample_period);
+        loop_heartbeat.beat();
+        // the motors are stopped already
+        if (watchdog.is_tripped()) {
+            break;
+        }
+
+        const auto now = steady_clock::now();
+        if (now - window_start < settle_window) {
+            continue;
+        }
+
+        const int left_pos = left_wheel.get_position_pulses();
+        const int right_pos = right_wheel.get_position_pulses();
+
+        if (abs(left_pos - left_window_start) <= settle_pulses && abs(right_pos - right_window_start) <= settle_pulses) {
+            break;
+        }
+
+        window_start = now;
+        left_window_start = left_pos;
+        right_window_start = right_pos;
+    }
+
+    left_wheel.stop();
+    right_wheel.stop();
+    loop_heartbeat.disarm();
+    motion_deadline.disarm();
+    check_emergency_stop();
+
+    const auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+    Logger::debug("unregulated_move_until_settled - settled after", elapsed.count(), "ms");
+    return elapsed;
 }
@@ -1,4 +1,6 @@
+#include "autotune.hpp"
 #include "lib.hpp"
+#include "mission.hpp"
 
 /*
 TODO:
@@ -13,67 +15,72 @@ inline void clearing_corner ()
     move_wallbang(52cm, -90deg);
     move_segment(-4cm, -90deg);
     turn(12deg);
-    unregulated_move(-100, 1000ms);
+    unregulated_move_until_settled(-100, 1000ms);
 }
 
-[[noreturn]] void left_main ()
+void left_setup ()
 {
     left_wheel.set_polarity(TachoMotor::polarities::inversed);
     right_wheel.set_polarity(TachoMotor::polarities::inversed);
+}
+
+[[noreturn]] void left_main ()
+{
+    left_setup();
 
-    unregulated_move(-100, 400ms);
+    unregulated_move_until_settled(-100, 400ms);
 
-    gyro.reset();
+    reset_heading();
 
-    move_wallbang(114cm, 0deg);
+    move_wallbang(114cm, 0deg, when_remaining(10cm, lift_up<false>));
     unregulated_move(70, 200ms);
-    lift_up();
+    join_arm();
     unregulated_move(70, 50ms);
     unregulated_move(-70, 50ms);
     turn(-10deg);
     lift_down();
     move_wallbang(-127cm, -13deg);
-    unregulated_move(-100, 400ms);
+    unregulated_move_until_settled(-100, 400ms);
 
-    move_wallbang(114cm, 0deg);
+    move_wallbang(114cm, 0deg, when_remaining(10cm, lift_up<false>));
     unregulated_move(70, 200ms);
-    lift_up();
+    join_arm();
     unregulated_move(70, 50ms);
     lift_down();
     unregulated_move(-70, 50ms);
     move_wallbang(-127cm, 0deg);
-    unregulated_move(-100, 400ms);
+    unregulated_move_until_settled(-100, 400ms);
 
     while (true) {
         clearing_corner();
-        gyro.reset();
+        reset_heading();
 
-        move_wallbang(114cm, -1.5deg);
+        move_wallbang(114cm, -1.5deg, when_remaining(10cm, lift_up<false>));
         unregulated_move(70, 200ms);
-        lift_up();
+        join_arm();
         unregulated_move(70, 50ms);
         unregulated_move(-70, 50ms);
         lift_down();
         move_wallbang(-130cm, -10deg);
-        unregulated_move(-100, 400ms);
+        unregulated_move_until_settled(-100, 400ms);
 
-        move_wallbang(114cm, 0deg);
+        move_wallbang(114cm, 0deg, when_remaining(10cm, lift_up<false>));
         unregulated_move(70, 200ms);
-        lift_up();
+        join_arm();
         unregulated_move(70, 50ms);
         unregulated_move(-70, 50ms);
         lift_down();
         move_wallbang(-127cm, -10deg);
-        unregulated_move(-100, 400ms);
+        unregulated_move_until_settled(-100, 400ms);
 
-        move_wallbang(114cm, 2deg);
+        move_wallbang(114cm, 2deg, when_remaining(10cm, lift_up<false>));
         unregulated_move(70, 200ms);
-        lift_up();
+        join_arm();
         unregulated_move(70, 50ms);
         unregulated_move(-70, 50ms);
         lift_down();
         move_wallbang(-127cm, 0deg);
-        unregulated_move(-100, 400ms);
+        unregulated_move_until_settled(-100, 400ms);
     }
 
     exit(EXIT_SUCCESS);
@@ -81,26 +88,33 @@ inline void clearing_corner ()
 
 inline void shoot_arm ()
 {
+    check_emergency_stop();
     arm.set_duty_cycle_setpoint(-100);
     
 }
 
 inline void collect_arm()
 {
+    check_emergency_stop();
     arm.set_duty_cycle_setpoint(40);
 }
 
-[[noreturn]] void right_main ()
+void right_setup ()
 {
     collect_arm();
     arm.run_command(TachoMotor::commands::run_direct);
 
     left_wheel.set_polarity(TachoMotor::polarities::normal);
     right_wheel.set_polarity(TachoMotor::polarities::normal);
+}
 
-    unregulated_move(-100, 400ms);
+[[noreturn]] void right_main ()
+{
+    right_setup();
+
+    unregulated_move_until_settled(-100, 400ms);
 
-    gyro.reset();
+    reset_heading();
 
     arm.set_duty_cycle_setpoint(-100);
     arm.run_command(TachoMotor::commands::run_direct);
@@ -112,7 +126,7 @@ inline void collect_arm()
     move_wallbang(-77cm, -20deg);
     collect_arm();
 
-    unregulated_move(-100, 400ms);
+    unregulated_move_until_settled(-100, 400ms);
 
     move_segment(68.5cm, 0deg);
     move_segment(-5cm, 0deg);
@@ -124,30 +138,32 @@ inline void collect_arm()
 
     turn(0deg);
     while (true) {
-        unregulated_move(-100, 400ms);
+        unregulated_move_until_settled(-100, 400ms);
         move_segment(3.5cm, 0deg);
         turn(90deg);
         move_segment(-15cm, 90deg);
         move_wallbang(65cm, 90deg);
         move_segment(-7cm, 90deg);
         turn(-25deg);
-        unregulated_move(-100, 600ms);
+        unregulated_move_until_settled(-100, 600ms);
 
         move_wallbang(68.5cm, 1deg);
         shoot_arm();
         move_wallbang(-75cm, 8.5deg);
         collect_arm();
-        unregulated_move(-100, 400ms);
+        unregulated_move_until_settled(-100, 400ms);
 
-        gyro.reset();
-        Logger::info(gyro.get_angle(), gyro.base);
+        reset_heading();
+        if (use_gyro_processor) {
+            gyro_processor.log_statistics();
+        }
 
 
         move_wallbang(68.5cm, 0deg);
         shoot_arm();
         move_wallbang(-75cm, 8.5deg);
         collect_arm();
-        unregulated_move(-100, 400ms);
+        unregulated_move_until_settled(-100, 400ms);
 
         move_wallbang(68.5cm, -2deg);
         shoot_arm();
@@ -158,22 +174,78 @@ inline void collect_arm()
     exit(EXIT_SUCCESS);
 }
 
-int main () 
+void setup ()
+{
+    if constexpr (std::is_same_v<Robot, Ferenc>) {
+        left_setup();
+    } else {
+        right_setup();
+    }
+}
+
+/// @brief Loads and runs a mission script instead of the compiled routine.
+void run_mission (const std::string &path)
+{
+    Mission mission;
+    if (!mission.load(path)) {
+        return;
+    }
+
+    setup();
+    mission.run();
+}
+
+int main (int argc, char **argv) 
 {
     std::ios_base::sync_with_stdio(false);
     std::cin.tie(nullptr);
     std::cout.tie(nullptr);
 
+    status_lights.start();
+    status_lights.show(StatusLights::patterns::busy);
+
+    configure_sensors();
     gyro.set_mode(GyroSensor::modes::calibration);
     sleep(150ms);
     gyro.set_mode(GyroSensor::modes::angle_and_rate);
     sleep(150ms);
+    start_watchdog();
+
+    // before the heading is started, the calibration reads the gyro in both modes
+    if (argc > 1 && std::string_view(argv[1]) == "gyro") {
+        setup();
+        calibrate_gyro_scale();
+        return EXIT_SUCCESS;
+    }
+
+    start_heading();
+    status_lights.show(StatusLights::patterns::running);
 
-    #if FRT_ROBOT_ID == 0
-    left_main();
-    #else
-    right_main();
-    #endif
+    if (argc > 1 && std::string_view(argv[1]) == "tune") {
+        setup();
+        autotune();
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "identify") {
+        setup();
+        identify_motors();
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1) {
+        run_mission(argv[1]);
+        status_lights.show(StatusLights::patterns::error);
+        Logger::error("Mission exited unexpectedly.");
+        return EXIT_FAILURE;
+    }
+
+    if constexpr (std::is_same_v<Robot, Ferenc>) {
+        left_main();
+    } else {
+        right_main();
+    }
 
+    status_lights.show(StatusLights::patterns::error);
     Logger::error("Control loop exited unexpectedly.");
 }
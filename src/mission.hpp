@@ -0,0 +1,271 @@
+#pragma once
+
+#include "lib.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <optional>
+
+/*
+Mission scripts describe a routine as one action per line, '#' starts a comment.
+Lengths accept mm, cm, dm and m, angles deg, rad and grad, durations ms and s.
+
+    move_segment <length> <angle> [lift_at <length>]
+    move_wallbang <length> <angle> [lift_at <length>]
+    turn <angle>
+    lift up|down
+    join
+    unregulated_move <duty cycle> <duration>
+    align <duty cycle> <timeout>
+    arm <duty cycle>
+    gyro_reset
+    beep <frequency> <duration>
+    loop
+
+`lift_at` starts lifting the arm without blocking when the motion is within the given distance of its end,
+`join` waits for the arm to finish, `beep` is a cue that does not wait for the tone.
+Everything after `loop` is repeated forever once the end of the script is reached.
+*/
+
+struct MissionAction
+{
+    enum class Type : uint8_t
+    {
+        move_segment,
+        move_wallbang,
+        turn,
+        lift_up,
+        lift_down,
+        join,
+        unregulated_move,
+        align,
+        arm,
+        gyro_reset,
+        beep,
+    };
+
+    Type type;
+    // lengths are stored in cm, angles in deg and durations in ms
+    double first = 0;
+    double second = 0;
+    // negative if the motion has no lift trigger attached
+    double lift_at = -1;
+};
+
+class Mission
+{
+    private:
+        enum class Quantity
+        {
+            length,
+            angle,
+            duration,
+            number,
+        };
+
+        std::vector<MissionAction> actions;
+        size_t loop_start = 0;
+        bool loop = false;
+
+        static std::optional<double> parse_quantity (const std::string_view token, const Quantity quantity)
+        {
+            double value;
+            const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (error != std::errc()) {
+                return std::nullopt;
+            }
+
+            const std::string_view suffix(end, token.data() + token.size() - end);
+
+            switch (quantity) {
+                case Quantity::length:
+                    if (suffix == "mm") return length_cast<cm>(mm(value)).value;
+                    if (suffix == "cm") return value;
+                    if (suffix == "dm") return length_cast<cm>(dm(value)).value;
+                    if (suffix == "m") return length_cast<cm>(m(value)).value;
+                    break;
+                case Quantity::angle:
+                    if (suffix == "deg") return value;
+                    if (suffix == "rad") return angle_cast<deg>(rad(value)).value;
+                    if (suffix == "grad") return angle_cast<deg>(grad(value)).value;
+                    break;
+                case Quantity::duration:
+                    if (suffix == "ms") return value;
+                    if (suffix == "s") return value * 1000;
+                    break;
+                case Quantity::number:
+                    if (suffix.empty()) return value;
+                    break;
+            }
+
+            return std::nullopt;
+        }
+
+        static std::vector<std::string> tokenize (const std::string &line)
+        {
+            std::istringstream stream(line.substr(0, line.find('#')));
+            std::vector<std::string> tokens;
+            std::string token;
+            while (stream >> token) {
+                tokens.emplace_back(std::move(token));
+            }
+            return tokens;
+        }
+
+        bool parse_line (const std::vector<std::string> &tokens)
+        {
+            const auto &name = tokens[0];
+
+            const auto action = [&] (const MissionAction::Type type, const std::initializer_list<Quantity> quantities, const bool triggers = false) {
+                MissionAction result { .type = type };
+
+                const size_t trigger_index = quantities.size() + 1;
+                if (triggers && tokens.size() == trigger_index + 2 && tokens[trigger_index] == "lift_at") {
+                    const auto value = parse_quantity(tokens[trigger_index + 1], Quantity::length);
+                    if (!value || *value < 0) {
+                        return false;
+                    }
+                    result.lift_at = *value;
+                }
+                else if (tokens.size() != quantities.size() + 1) {
+                    return false;
+                }
+
+                double *operands[] = { &result.first, &result.second };
+                size_t index = 0;
+                for (const auto quantity : quantities) {
+                    const auto value = parse_quantity(tokens[index + 1], quantity);
+                    if (!value) {
+                        return false;
+                    }
+                    *operands[index++] = *value;
+                }
+                actions.push_back(result);
+                return true;
+            };
+
+            if (name == "move_segment") return action(MissionAction::Type::move_segment, { Quantity::length, Quantity::angle }, true);
+            if (name == "move_wallbang") return action(MissionAction::Type::move_wallbang, { Quantity::length, Quantity::angle }, true);
+            if (name == "turn") return action(MissionAction::Type::turn, { Quantity::angle });
+            if (name == "unregulated_move") return action(MissionAction::Type::unregulated_move, { Quantity::number, Quantity::duration });
+            if (name == "align") return action(MissionAction::Type::align, { Quantity::number, Quantity::duration });
+            if (name == "arm") return action(MissionAction::Type::arm, { Quantity::number });
+            if (name == "gyro_reset") return action(MissionAction::Type::gyro_reset, {});
+            if (name == "beep") return action(MissionAction::Type::beep, { Quantity::number, Quantity::duration });
+            if (name == "join") return action(MissionAction::Type::join, {});
+
+            if (name == "lift" && tokens.size() == 2) {
+                if (tokens[1] != "up" && tokens[1] != "down") {
+                    return false;
+                }
+                actions.push_back({ .type = tokens[1] == "up" ? MissionAction::Type::lift_up : MissionAction::Type::lift_down });
+                return true;
+            }
+
+            if (name == "loop" && tokens.size() == 1 && !loop) {
+                loop = true;
+                loop_start = actions.size();
+                return true;
+            }
+
+            return false;
+        }
+
+        static void execute (const MissionAction &action)
+        {
+            using Type = MissionAction::Type;
+            const auto duration = std::chrono::milliseconds(lround(action.second));
+
+            switch (action.type) {
+                case Type::move_segment:
+                    if (action.lift_at < 0) {
+                        move_segment(cm(action.first), deg(action.second));
+                    } else {
+                        move_segment(cm(action.first), deg(action.second), when_remaining(cm(action.lift_at), lift_up<false>));
+                    }
+                    break;
+                case Type::move_wallbang:
+                    if (action.lift_at < 0) {
+                        move_wallbang(cm(action.first), deg(action.second));
+                    } else {
+                        move_wallbang(cm(action.first), deg(action.second), when_remaining(cm(action.lift_at), lift_up<false>));
+                    }
+                    break;
+                case Type::turn:
+                    turn(deg(action.first));
+                    break;
+                case Type::lift_up:
+                    lift_up();
+                    break;
+                case Type::lift_down:
+                    lift_down();
+                    break;
+                case Type::join:
+                    join_arm();
+                    break;
+                case Type::unregulated_move:
+                    unregulated_move(lround(action.first), duration);
+                    break;
+                case Type::align:
+                    unregulated_move_until_settled(lround(action.first), duration);
+                    break;
+                case Type::arm:
+                    arm.set_duty_cycle_setpoint(lround(action.first));
+                    break;
+                case Type::gyro_reset:
+                    reset_heading();
+                    break;
+                case Type::beep:
+                    Sound::beep<true>(lround(action.first), duration.count());
+                    break;
+            }
+        }
+
+    public:
+        /// @brief Parses a mission script, replacing the previously loaded one.
+        /// @returns False if the file cannot be opened or contains an invalid line.
+        bool load (const std::string &path)
+        {
+            std::ifstream file(path);
+            if (!file.is_open()) {
+                Logger::error("Mission::load - cannot open file", path);
+                return false;
+            }
+
+            actions.clear();
+            loop = false;
+            loop_start = 0;
+
+            std::string line;
+            int line_number = 0;
+            while (std::getline(file, line)) {
+                line_number++;
+                const auto tokens = tokenize(line);
+                if (tokens.empty()) {
+                    continue;
+                }
+                if (!parse_line(tokens)) {
+                    Logger::error("Mission::load - invalid action in", path, "at line", line_number, ":", line);
+                    return false;
+                }
+            }
+
+            actions.shrink_to_fit();
+            Logger::info("Mission::load - loaded", actions.size(), "actions from", path);
+            return true;
+        }
+
+        /// @brief Executes the loaded actions. Never returns if the script contains a loop.
+        void run () const
+        {
+            size_t index = 0;
+            while (index < actions.size()) {
+                // ends the program once stopped, actions without a motion would otherwise run on
+                check_emergency_stop();
+                execute(actions[index++]);
+                if (index == actions.size() && loop) {
+                    index = loop_start;
+                }
+            }
+        }
+};
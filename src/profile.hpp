@@ -0,0 +1,170 @@
+#pragma once
+
+#include <frt/frt.hpp>
+
+#include <chrono>
+#include <string_view>
+#include <type_traits>
+
+using namespace FRT;
+using namespace FRT::unit_literals;
+
+/*
+Robot profiles collect everything that differs between the robots: ports, geometry, gains and limits.
+Controllers take the profile as a template parameter, so these constants fold at compile time.
+*/
+
+struct Ferenc
+{
+    static constexpr std::string_view name = "ferenc";
+    static constexpr std::string_view parameters_path = "/home/robot/bin/ferenc.parameters";
+    static constexpr std::string_view motor_models_path = "/home/robot/bin/ferenc.motors";
+
+    struct ports
+    {
+        static constexpr std::string_view gyro = INPUT_1;
+        static constexpr std::string_view left_wheel = OUTPUT_B;
+        static constexpr std::string_view right_wheel = OUTPUT_C;
+        static constexpr std::string_view arm = OUTPUT_A;
+    };
+
+    // 5 cm wheels with a gear ratio of 3
+    static constexpr cm wheel_diameter = 5 * 3.0;
+    // gear has 12 teeth, rack has one tooth per 3.2mm
+    static constexpr mm arm_diameter = 12.0 * 3.2 / M_PI;
+
+    // static correction of the wheels' duty cycles
+    static constexpr double left_wheel_correction = 1;
+    static constexpr double right_wheel_correction = 1;
+
+    // degrees per second per raw unit of the gyro's fast mode, zero until measured by calibrate_gyro_scale
+    static constexpr double gyro_rate_scale = 0;
+
+    // sensor update periods in milliseconds, applied by configure_sensors
+    struct poll_ms
+    {
+        static constexpr int gyro = 5;
+    };
+
+    // the speed attribute of the motors is updated this often, an unchanged speed after it is still a new sample
+    static constexpr std::chrono::milliseconds speed_sample_period {10};
+
+    // emergency stop when a control loop stalls this long, a turn takes longer than this,
+    // or the arm is still running after its deadline, longer than lift_down takes
+    struct safety
+    {
+        static constexpr std::chrono::milliseconds loop_deadline {250};
+        static constexpr std::chrono::milliseconds turn_deadline {5000};
+        static constexpr std::chrono::milliseconds arm_deadline {8000};
+    };
+
+    // the speed gains (Kp, Ki, Kd) of the motions step once per new speed sample, every speed_sample_period,
+    // the direction gains (Dp, Di, Dd) in every loop iteration. The speed gains below were tuned when they stepped
+    // in every iteration too, so they act slower now, the tune subcommand measures them per sample
+    struct move_control
+    {
+        static constexpr double Kp = 0.0008, Ki = 0, Kd = 0.00002;
+        static constexpr double Dp = 3, Di = 0.01, Dd = 0.5;
+    };
+
+    struct segment_control
+    {
+        static constexpr cm end_threshold = 60;
+        static constexpr deg target_speed = 1050;
+        static constexpr double ramp_base = 0;
+    };
+
+    struct turn_control
+    {
+        static constexpr double Kp = 0, Ki = 0, Kd = 0;
+        static constexpr double Dp = 0.5, Di = 0.01, Dd = 0.1;
+    };
+
+    struct turn_motion
+    {
+        static constexpr double Kp = 0.008, Ki = 0.00000007, Kd = 0.00002;
+        static constexpr double sp_limit = 70;
+        static constexpr deg max_speed = 200;
+        static constexpr double base_speed_target = 0.2;
+    };
+};
+
+struct Viktor
+{
+    static constexpr std::string_view name = "viktor";
+    static constexpr std::string_view parameters_path = "/home/robot/bin/viktor.parameters";
+    static constexpr std::string_view motor_models_path = "/home/robot/bin/viktor.motors";
+
+    struct ports
+    {
+        static constexpr std::string_view gyro = INPUT_1;
+        static constexpr std::string_view left_wheel = OUTPUT_C;
+        static constexpr std::string_view right_wheel = OUTPUT_B;
+        static constexpr std::string_view arm = OUTPUT_A;
+    };
+
+    static constexpr cm wheel_diameter = 5 * (36.0 / 20.0);
+    // the arm is only driven by duty cycle
+    static constexpr cm arm_diameter = 0;
+
+    static constexpr double left_wheel_correction = 1;
+    static constexpr double right_wheel_correction = 1;
+
+    // degrees per second per raw unit of the gyro's fast mode, zero until measured by calibrate_gyro_scale
+    static constexpr double gyro_rate_scale = 0;
+
+    // sensor update periods in milliseconds, applied by configure_sensors
+    struct poll_ms
+    {
+        static constexpr int gyro = 5;
+    };
+
+    // the speed attribute of the motors is updated this often, an unchanged speed after it is still a new sample
+    static constexpr std::chrono::milliseconds speed_sample_period {10};
+
+    // emergency stop when a control loop stalls this long, a turn takes longer than this,
+    // or the arm is still running after its deadline, longer than lift_down takes
+    struct safety
+    {
+        static constexpr std::chrono::milliseconds loop_deadline {250};
+        static constexpr std::chrono::milliseconds turn_deadline {5000};
+        static constexpr std::chrono::milliseconds arm_deadline {8000};
+    };
+
+    // the speed gains (Kp, Ki, Kd) of the motions step once per new speed sample, every speed_sample_period,
+    // the direction gains (Dp, Di, Dd) in every loop iteration. The speed gains below were tuned when they stepped
+    // in every iteration too, so they act slower now, the tune subcommand measures them per sample
+    struct move_control
+    {
+        static constexpr double Kp = 0.0012, Ki = 0, Kd = 0.00002;
+        static constexpr double Dp = 3, Di = 0.01, Dd = 0.5;
+    };
+
+    struct segment_control
+    {
+        static constexpr cm end_threshold = 60;
+        static constexpr deg target_speed = 1050;
+        static constexpr double ramp_base = 0.2;
+    };
+
+    struct turn_control
+    {
+        static constexpr double Kp = 0, Ki = 0, Kd = 0;
+        static constexpr double Dp = 0.5, Di = 0.01, Dd = 0.1;
+    };
+
+    struct turn_motion
+    {
+        static constexpr double Kp = 0.008, Ki = 0.0000001, Kd = 0.00003;
+        static constexpr double sp_limit = 100;
+        static constexpr deg max_speed = 320;
+        static constexpr double base_speed_target = 0.1;
+    };
+};
+
+#if !defined FRT_ROBOT_ID || (FRT_ROBOT_ID != 0) && (FRT_ROBOT_ID != 1)
+#error FRT_ROBOT_ID not defined.
+#endif
+
+// the profile this binary is built for
+using Robot = std::conditional_t<FRT_ROBOT_ID == 0, Ferenc, Viktor>;
@@ -0,0 +1,53 @@
+#include <frt/src/parameters.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+/*
+Lists or changes the tunable parameters of a robot program, also while it is running.
+It touches no devices, so it is safe to run next to the control program.
+
+Only set parameters override the defaults of the program, the defaults are listed as the program last used them.
+
+usage:
+    params <file>                   lists every parameter, set ones are marked with a *
+    params <file> <name> <value>    sets a parameter
+    params <file> <name> default    returns a parameter to the default of the program
+*/
+
+using namespace FRT;
+
+int main (int argc, char **argv)
+{
+    if (argc != 2 && argc != 4) {
+        std::cerr << "usage: " << argv[0] << " <file> [<name> <value>|default]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ParameterStore parameters(argv[1]);
+    if (!parameters.is_open()) {
+        return EXIT_FAILURE;
+    }
+
+    if (argc == 4 && std::string_view(argv[3]) == "default") {
+        if (!parameters.reset(argv[2])) {
+            std::cerr << "unknown parameter: " << argv[2] << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else if (argc == 4) {
+        char *end;
+        const double value = std::strtod(argv[3], &end);
+        if (end == argv[3] || *end != '\0') {
+            std::cerr << "invalid value: " << argv[3] << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!parameters.set(argv[2], value)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    parameters.for_each([] (const std::string_view name, const ParameterStore::Entry entry) {
+        std::cout << name << " " << entry.value << (entry.overridden ? " *" : "") << "\n";
+    });
+}